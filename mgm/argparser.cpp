@@ -12,6 +12,21 @@ ArgParser::Arguments ArgParser::parse(int argc, char **argv) {
     try {
         this->app.parse((argc), (argv));
 
+        if (*this->convert_command) {
+            this->args.convert          = true;
+            this->args.convert_input    = fs::absolute(this->args.convert_input);
+            this->args.convert_output   = fs::absolute(this->args.convert_output);
+            return this->args;
+        }
+
+        // Required for optimization, but not for subcommands.
+        if (!*this->input_file_option)
+            throw CLI::RequiredError("--infile");
+        if (!*this->output_path_option)
+            throw CLI::RequiredError("--outpath");
+        if (!*this->optimization_mode_option)
+            throw CLI::RequiredError("--mode");
+
         this->args.input_file   = fs::absolute(this->args.input_file);
         this->args.output_path  = fs::absolute(this->args.output_path);
         if (*this->labeling_path_option) {
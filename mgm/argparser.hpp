@@ -35,6 +35,11 @@ class ArgParser {
             improveopt_par,
             qap
         };
+        enum solution_format {
+            json,
+            binary,
+            cliques
+        };
         struct Arguments {
             fs::path input_file;
             fs::path output_path;
@@ -52,6 +57,19 @@ class ArgParser {
 
             bool synchronize            = false;
             bool synchronize_infeasible = false;
+
+            bool report_memory = false;
+
+            solution_format output_format = json;
+            bool skip_energy = false;
+
+            bool lazy = false;
+            size_t lazy_budget = 0; // MiB
+
+            // mgm convert
+            bool convert = false;
+            fs::path convert_input;
+            fs::path convert_output;
         };
 
     //TODO: Consider making this a static function
@@ -76,6 +94,10 @@ class ArgParser {
                                                                         {"improveopt-par", optimization_mode::improveopt_par},
                                                                         {"qap", optimization_mode::qap}};
 
+        std::map<std::string, ArgParser::solution_format> solution_format_map {{"json", solution_format::json},
+                                                                               {"binary", solution_format::binary},
+                                                                               {"cliques", solution_format::cliques}};
+
         Arguments args;
 
         CLI::App app{"Multi-Graph Matching Optimizer"};
@@ -83,16 +105,14 @@ class ArgParser {
         /*
         * [[maybe_unused]] supresses warning for unused variables.
         */
-        // Required options
+        // Required options (unless running a subcommand)
         [[maybe_unused]]
         CLI::Option* input_file_option   = app.add_option("-i,--infile", this->args.input_file)
-            ->description("Path to .dd input file.")
-            ->required();
+            ->description("Path to .dd or .mgmb input file.");
 
         [[maybe_unused]] 		
         CLI::Option* output_path_option  = app.add_option("-o,--outpath", this->args.output_path)
-            ->description("Path to output directory.")
-            ->required();  
+            ->description("Path to output directory.");
 
         [[maybe_unused]] 		
         CLI::Option* output_filename_option  = app.add_option("--name", this->args.output_filename)
@@ -122,7 +142,6 @@ class ArgParser {
                             "improveopt:            improve a given labeling with alternating sequential GM-LS <-> SWAP-LS\n"
                             "improveopt-par:        improve a given labeling with alternating parallel GM-LS <-> SWAP-LS\n"
                             "qap:                   Single GM-Mode. Parse a graph matching .dd file and solve the qap problem.")
-            ->required()
             ->transform(CLI::CheckedTransformer(mode_map, CLI::ignore_case));
 
         [[maybe_unused]]		
@@ -153,6 +172,44 @@ class ArgParser {
         CLI::Option* synchronize_infeasible_option  = app.add_flag("--synchronize-infeasible", this->args.synchronize_infeasible)
             ->description("Synchronize a cylce inconsistent solution. Allow all (forbidden) matchings.")
             ->excludes(synchronize_option);
+
+        [[maybe_unused]]		
+        CLI::Option* report_memory_option  = app.add_flag("--report-memory", this->args.report_memory)
+            ->description("Log memory usage of model and solution after each phase, and the peak memory usage of the process.");
+
+        [[maybe_unused]]
+        CLI::Option* solution_format_option  = app.add_option("--solution-format", this->args.output_format)
+            ->description("File format of the solution.\n"
+                            "json:       pairwise labeling (.json)\n"
+                            "binary:     pairwise labeling in a compact binary format (.mgms)\n"
+                            "cliques:    clique table, one clique per line (.cliques)")
+            ->transform(CLI::CheckedTransformer(solution_format_map, CLI::ignore_case));
+
+        [[maybe_unused]]
+        CLI::Option* skip_energy_option  = app.add_flag("--skip-energy", this->args.skip_energy)
+            ->description("Do not evaluate the energy of the solution when storing it.");
+
+        CLI::Option* lazy_option  = app.add_flag("--lazy", this->args.lazy)
+            ->description("Load the models of graph pairs on first access instead of parsing the whole file up front.");
+
+        [[maybe_unused]]
+        CLI::Option* lazy_budget_option  = app.add_option("--lazy-budget", this->args.lazy_budget)
+            ->description("Memory budget in MiB for lazily loaded models. Least recently used models are dropped to stay within the budget.")
+            ->needs(lazy_option);
+
+        // Subcommands
+        CLI::App* convert_command = app.add_subcommand("convert", "Convert a model between the .dd and the binary .mgmb format. "
+                                                                  "The direction is given by the file extension of the input file.");
+
+        [[maybe_unused]]
+        CLI::Option* convert_input_option  = convert_command->add_option("-i,--infile", this->args.convert_input)
+            ->description("Path to .dd or .mgmb input file.")
+            ->required();
+
+        [[maybe_unused]]
+        CLI::Option* convert_output_option = convert_command->add_option("-o,--outfile", this->args.convert_output)
+            ->description("Path to output file.")
+            ->required();
 };
 
 #endif
\ No newline at end of file
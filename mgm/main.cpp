@@ -22,15 +22,37 @@ mgm::GmSolution solve_qap(ArgParser::Arguments args) {
         spdlog::info("Constructing QAP solver...");
         mgm::QAPSolver solver(model);
 
+        if (args.report_memory) {
+            report_memory("model", model->memory_usage());
+            report_memory("qap solver", solver.memory_usage());
+        }
+
         spdlog::info("Running QAP solver...");
         return solver.run();
     }
 }
 
+// .mgmb -> .dd, everything else is parsed as .dd -> .mgmb
+void convert_model(const fs::path& input_file, const fs::path& output_file) {
+    if (input_file.extension() == ".mgmb") {
+        auto model = mgm::io::parse_binary(input_file);
+        mgm::io::export_dd_file(output_file, model);
+    }
+    else {
+        auto model = mgm::io::parse_dd_file(input_file);
+        mgm::io::export_binary(output_file, model);
+    }
+}
+
 int main(int argc, char **argv) {
     ArgParser argparser;
     ArgParser::Arguments args = argparser.parse(argc, argv);
 
+    if (args.convert) {
+        convert_model(args.convert_input, args.convert_output);
+        return 0;
+    }
+
     auto loglevel = spdlog::level::level_enum::info;
     #ifndef NDEBUG
         loglevel = spdlog::level::level_enum::debug;
@@ -52,7 +74,21 @@ int main(int argc, char **argv) {
     auto r = Runner(args);
     auto solution = r.run();
 
-    mgm::io::save_to_disk((args.output_path / args.output_filename), solution);
+    if (args.report_memory) {
+        report_memory("solution", solution.memory_usage());
+    }
+
+    auto output_file = args.output_path / args.output_filename;
+    switch (args.output_format) {
+        case ArgParser::solution_format::binary:
+            mgm::io::save_binary_solution(output_file, solution, !args.skip_energy);
+            break;
+        case ArgParser::solution_format::cliques:
+            mgm::io::save_clique_table(output_file, solution, !args.skip_energy);
+            break;
+        default:
+            mgm::io::save_to_disk(output_file, solution, !args.skip_energy);
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -1,18 +1,62 @@
 #include <stdexcept>
 #include <spdlog/spdlog.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
 #include <libmgm/mgm.hpp>
 
 #include "argparser.hpp"
 
 #include "runner.hpp"
 
+namespace {
+constexpr double MIB = 1024.0 * 1024.0;
+
+// 0, if not available on this platform.
+size_t peak_rss_bytes() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    #ifdef __APPLE__
+        return usage.ru_maxrss;         // bytes
+    #else
+        return usage.ru_maxrss * 1024;  // kilobytes
+    #endif
+#else
+    return 0;
+#endif
+}
+}
+
+void report_memory(const std::string& phase, const mgm::MemoryUsage& usage) {
+    spdlog::info("Memory usage ({}): {:.2f} MiB. Peak RSS: {:.2f} MiB", phase, usage.total() / MIB, peak_rss_bytes() / MIB);
+    for (const auto& [component, bytes] : usage.components) {
+        spdlog::info("    {:<40} {:>10.2f} MiB", component, bytes / MIB);
+    }
+}
+
+void Runner::report_matching_memory(const std::string& phase, const mgm::MemoryUsage& usage) const {
+    if (this->args.report_memory) {
+        report_memory(phase + ", largest matching", usage);
+    }
+}
+
 Runner::Runner(ArgParser::Arguments args) : args(args) {
     spdlog::info("Loading model...");
     if (args.unary_constant != 0.0){
         spdlog::info("Using custom unary constant {}", args.unary_constant);
     }
     
-    this->model = mgm::io::parse_dd_file(args.input_file, args.unary_constant);
+    if (args.lazy) {
+        this->model = mgm::io::open_lazy(args.input_file, args.lazy_budget * 1024 * 1024, args.unary_constant);
+    }
+    else if (args.input_file.extension() == ".mgmb") {
+        this->model = mgm::io::parse_binary(args.input_file, args.unary_constant);
+    }
+    else {
+        this->model = mgm::io::parse_dd_file(args.input_file, args.unary_constant);
+    }
 
     // If run as a synchronizaiton algorithm, transform the model with the given solution.
     if (args.synchronize || args.synchronize_infeasible) {
@@ -21,20 +65,30 @@ Runner::Runner(ArgParser::Arguments args) : args(args) {
 
         this->model = mgm::build_sync_problem(this->model, s, feasible);
     }
+
+    if (args.report_memory) {
+        report_memory("model", this->model->memory_usage());
+    }
 }
 
 mgm::MgmSolution Runner::run_seq() {
     auto solver = mgm::SequentialGenerator(model);
     (void) solver.init(mgm::MgmGenerator::matching_order::random);
 
-    return solver.generate();
+    auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
+
+    return sol;
 }
 
 mgm::MgmSolution Runner::run_par() {
     auto solver = mgm::ParallelGenerator(model);
     (void) solver.init(mgm::MgmGenerator::matching_order::random);
     
-    return solver.generate();
+    auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
+
+    return sol;
 }
 
 mgm::MgmSolution Runner::run_inc() {
@@ -44,7 +98,10 @@ mgm::MgmSolution Runner::run_inc() {
     auto solver = mgm::IncrementalGenerator(this->args.incremental_set_size, model);
     (void) solver.init(mgm::MgmGenerator::matching_order::random);
     
-    return solver.generate();
+    auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
+
+    return sol;
 }
 
 mgm::MgmSolution Runner::run_seqseq()
@@ -52,9 +109,11 @@ mgm::MgmSolution Runner::run_seqseq()
     auto solver = mgm::SequentialGenerator(model);
     auto search_order = solver.init(mgm::MgmGenerator::matching_order::random);
     auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
 
     auto local_searcher = mgm::GMLocalSearcher(this->model, search_order);
     local_searcher.search(sol);
+    this->report_matching_memory("local search", local_searcher.peak_matching_memory());
 
     return sol;
 }
@@ -64,9 +123,11 @@ mgm::MgmSolution Runner::run_seqpar()
     auto solver = mgm::SequentialGenerator(model);
     auto search_order = solver.init(mgm::MgmGenerator::matching_order::random);
     auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
 
     auto local_searcher = mgm::GMLocalSearcherParallel(this->model, !this->args.merge_one);
     local_searcher.search(sol);
+    this->report_matching_memory("local search", local_searcher.peak_matching_memory());
 
     return sol;
 }
@@ -76,9 +137,11 @@ mgm::MgmSolution Runner::run_parseq()
     auto solver = mgm::ParallelGenerator(model);
     auto search_order = solver.init(mgm::MgmGenerator::matching_order::random);
     auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
 
     auto local_searcher = mgm::GMLocalSearcher(this->model, search_order);
     local_searcher.search(sol);
+    this->report_matching_memory("local search", local_searcher.peak_matching_memory());
 
     return sol;
 }
@@ -88,9 +151,11 @@ mgm::MgmSolution Runner::run_parpar()
     auto solver = mgm::ParallelGenerator(model);
     auto search_order = solver.init(mgm::MgmGenerator::matching_order::random);
     auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
 
     auto local_searcher = mgm::GMLocalSearcherParallel(this->model, !this->args.merge_one);
     local_searcher.search(sol);
+    this->report_matching_memory("local search", local_searcher.peak_matching_memory());
 
     return sol;
 }
@@ -104,9 +169,11 @@ mgm::MgmSolution Runner::run_incseq()
     auto search_order = solver.init(mgm::MgmGenerator::matching_order::random);
     
     auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
 
     auto local_searcher = mgm::GMLocalSearcher(this->model, search_order);
     local_searcher.search(sol);
+    this->report_matching_memory("local search", local_searcher.peak_matching_memory());
 
     return sol;
 }
@@ -120,9 +187,11 @@ mgm::MgmSolution Runner::run_incpar()
     (void) solver.init(mgm::MgmGenerator::matching_order::random);
     
     auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
 
     auto local_searcher = mgm::GMLocalSearcherParallel(this->model, !this->args.merge_one);
     local_searcher.search(sol);
+    this->report_matching_memory("local search", local_searcher.peak_matching_memory());
 
     return sol;
 }
@@ -131,6 +200,7 @@ mgm::MgmSolution Runner::run_optimal() {
     auto solver = mgm::SequentialGenerator(model);
     auto search_order = solver.init(mgm::MgmGenerator::matching_order::random);
     auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
 
     auto local_searcher = mgm::GMLocalSearcher(this->model, search_order);
     local_searcher.search(sol);
@@ -144,6 +214,7 @@ mgm::MgmSolution Runner::run_optimal() {
         if (improved) {
             improved = local_searcher.search(sol);
         } else {
+            this->report_matching_memory("local search", local_searcher.peak_matching_memory());
             return sol;
         }
     }
@@ -154,9 +225,11 @@ mgm::MgmSolution Runner::run_optimalpar() {
     auto solver = mgm::ParallelGenerator(model);
     (void) solver.init(mgm::MgmGenerator::matching_order::random);
     auto sol = solver.generate();
+    this->report_matching_memory("generator", solver.peak_matching_memory());
     
     auto local_searcher = mgm::GMLocalSearcherParallel(this->model, !this->args.merge_one);
     local_searcher.search(sol);
+    mgm::MemoryUsage peak;
 
     auto swap_local_searcher = mgm::SwapLocalSearcher(this->model);
 
@@ -165,10 +238,14 @@ mgm::MgmSolution Runner::run_optimalpar() {
         improved = swap_local_searcher.search(sol);
 
         if (improved) {
+            // Keep the peak of the previous searches.
+            mgm::details::keep_peak(peak, local_searcher.peak_matching_memory());
             local_searcher = mgm::GMLocalSearcherParallel(this->model, !this->args.merge_one);
 
             improved = local_searcher.search(sol);
         } else {
+            mgm::details::keep_peak(peak, local_searcher.peak_matching_memory());
+            this->report_matching_memory("local search", peak);
             return sol;
         }
     }
@@ -194,6 +271,7 @@ mgm::MgmSolution Runner::run_improve_qap()
 
     auto local_searcher = mgm::GMLocalSearcher(this->model);
     local_searcher.search(sol);
+    this->report_matching_memory("local search", local_searcher.peak_matching_memory());
 
     return sol;
 }
@@ -207,6 +285,7 @@ mgm::MgmSolution Runner::run_improve_qap_par()
 
     auto local_searcher = mgm::GMLocalSearcherParallel(this->model, !this->args.merge_one);
     local_searcher.search(sol);
+    this->report_matching_memory("local search", local_searcher.peak_matching_memory());
 
     return sol;
 }
@@ -230,6 +309,7 @@ mgm::MgmSolution Runner::run_improveopt()
         if (improved) {
             improved = local_searcher.search(sol);
         } else {
+            this->report_matching_memory("local search", local_searcher.peak_matching_memory());
             return sol;
         }
     }
@@ -255,6 +335,7 @@ mgm::MgmSolution Runner::run_improveopt_par()
         if (improved) {
             improved = local_searcher.search(sol);
         } else {
+            this->report_matching_memory("local search", local_searcher.peak_matching_memory());
             return sol;
         }
     }
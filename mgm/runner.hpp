@@ -1,10 +1,14 @@
 #ifndef MGM_RUNNER_HPP
 #define MGM_RUNNER_HPP
 
+#include <string>
 #include <libmgm/mgm.hpp>
 
 #include "argparser.hpp"
 
+// Logs the components of `usage` and the peak resident set size of the process so far.
+void report_memory(const std::string& phase, const mgm::MemoryUsage& usage);
+
 class Runner {
     public:
         Runner(ArgParser::Arguments args);
@@ -16,6 +20,9 @@ class Runner {
         
         ArgParser::Arguments args;
 
+        // Memory of the largest clique-to-clique matching of a phase, incl. its QAP solver. Only with --report-memory.
+        void report_matching_memory(const std::string& phase, const mgm::MemoryUsage& usage) const;
+
         mgm::MgmSolution run_seq();
         mgm::MgmSolution run_par();
         mgm::MgmSolution run_inc();
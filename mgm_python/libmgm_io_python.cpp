@@ -86,6 +86,41 @@ constexpr const char* save_to_disk_doc = R"doc(
         If filepath is a directory, the solution will be stored in a generically named file.
         Optionally, include the filename in the ``filepath`` argument to control the output file name.
     solution : :class:`pylibmgm.MgmSolution`
+    compute_energy : bool, optional
+        Evaluate and store the energy of the solution. Otherwise, the energy is stored as null.
+
+)doc";
+
+constexpr const char* save_binary_solution_doc = R"doc(
+    Store a MGM solution in the compact binary .mgms format on disk.
+
+    Load it again with :func:`pylibmgm.io.import_solution`.
+
+    Parameters
+    ----------
+    filepath : os.PathLike
+        If filepath is a directory, the solution will be stored in a generically named file.
+        Optionally, include the filename in the ``filepath`` argument to control the output file name.
+    solution : :class:`pylibmgm.MgmSolution`
+    compute_energy : bool, optional
+        Evaluate and store the energy of the solution.
+
+)doc";
+
+constexpr const char* save_clique_table_doc = R"doc(
+    Store a MGM solution as a clique table (.cliques) on disk.
+
+    One clique per line, as graph and node id pairs. Loading it with 
+    :func:`pylibmgm.io.import_solution` needs no conversion to a pairwise labeling.
+
+    Parameters
+    ----------
+    filepath : os.PathLike
+        If filepath is a directory, the solution will be stored in a generically named file.
+        Optionally, include the filename in the ``filepath`` argument to control the output file name.
+    solution : :class:`pylibmgm.MgmSolution`
+    compute_energy : bool, optional
+        Evaluate and store the energy of the solution.
 
 )doc";
 
@@ -107,9 +142,64 @@ constexpr const char* export_dd_file_doc = R"doc(
 
 )doc";
 
+constexpr const char* parse_binary_doc = R"doc(
+    Load an MGM model from a binary .mgmb file.
+
+    Binary files are much faster to load than .dd files. 
+    Create them with :func:`pylibmgm.io.export_binary`.
+
+    Parameters
+    ----------
+    mgmb_file : os.PathLike
+        The path to the .mgmb file to be loaded.
+    unary_constant : float, optional
+        A constant value to be added to the unary costs in the model.
+
+    Returns
+    -------
+    :class:`pylibmgm.MgmModel`
+
+)doc";
+
+constexpr const char* export_binary_doc = R"doc(
+    Exports a given MGM model to a binary .mgmb file.
+
+    Parameters
+    ----------
+    filepath : os.PathLike
+        Must not be a directory, but a file path.
+    model : :class:`pylibmgm.MgmModel`
+
+)doc";
+
+constexpr const char* open_lazy_doc = R"doc(
+    Index a .dd or .mgmb file without loading its costs.
+
+    Graph matching models are loaded on first access through 
+    :meth:`pylibmgm.MgmModel.gm_model`. The file must not be modified 
+    while the model is in use.
+
+    Parameters
+    ----------
+    model_file : os.PathLike
+        The path to the .dd or .mgmb file.
+    memory_budget : int, optional
+        Memory budget in bytes. If non-zero, the least recently used models are
+        dropped to stay within the budget and reloaded when needed again.
+    unary_constant : float, optional
+        A constant value to be added to the unary costs in the model.
+
+    Returns
+    -------
+    :class:`pylibmgm.MgmModel`
+
+)doc";
+
 constexpr const char* import_solution_doc = R"doc(
     Load a solution for a given MgmModel from disk.
 
+    Reads json, binary (.mgms) and clique table (.cliques) files, by file extension.
+
     To create a solution file for loading with this function, use 
     the :func:`pylibmgm.io.save_to_disk` function.
 
@@ -138,9 +228,33 @@ PYBIND11_MODULE(io, m_io)
             py::doc(parse_dd_file_gm_doc));
             
 
-    m_io.def("save_to_disk", py::overload_cast<std::filesystem::path, const mgm::MgmSolution&>(&mgm::io::save_to_disk), py::doc(save_to_disk_gm_doc));
+    m_io.def("save_to_disk", py::overload_cast<std::filesystem::path, const mgm::MgmSolution&, bool>(&mgm::io::save_to_disk), 
+            py::arg("filepath"),
+            py::arg("solution"),
+            py::arg("compute_energy") = true,
+            py::doc(save_to_disk_gm_doc));
     m_io.def("save_to_disk", py::overload_cast<std::filesystem::path, const mgm::GmSolution&>(&mgm::io::save_to_disk) , py::doc(save_to_disk_doc));
+    m_io.def("save_binary_solution", &mgm::io::save_binary_solution,
+            py::arg("filepath"),
+            py::arg("solution"),
+            py::arg("compute_energy") = true,
+            py::doc(save_binary_solution_doc));
+    m_io.def("save_clique_table", &mgm::io::save_clique_table,
+            py::arg("filepath"),
+            py::arg("solution"),
+            py::arg("compute_energy") = true,
+            py::doc(save_clique_table_doc));
     m_io.def("export_dd_file", &mgm::io::export_dd_file, py::doc(export_dd_file_doc)); // TODO: Write function for GM Model as well.
+    m_io.def("parse_binary", &mgm::io::parse_binary,
+            py::arg("mgmb_file"),
+            py::arg("unary_constant") = 0.0,
+            py::doc(parse_binary_doc));
+    m_io.def("export_binary", &mgm::io::export_binary, py::doc(export_binary_doc));
+    m_io.def("open_lazy", &mgm::io::open_lazy,
+            py::arg("model_file"),
+            py::arg("memory_budget") = 0,
+            py::arg("unary_constant") = 0.0,
+            py::doc(open_lazy_doc));
     m_io.def("import_solution", &mgm::io::import_from_disk, py::doc(import_solution_doc));
 
     m_io.def("_register_io_logger", &register_python_logger, "Register a Python logger with spdlog");
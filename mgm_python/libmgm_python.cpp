@@ -1,7 +1,9 @@
 #include <libmgm/mgm.hpp>
+#include <map>
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include <omp.h>
 
 #include "logging_adapter.hpp"
@@ -14,9 +16,8 @@ void mgm_model_add_model(MgmModel& mgm_model, std::shared_ptr<GmModel> gm_model)
     int g1 = gm_model->graph1.id;
     int g2 = gm_model->graph2.id;
 
-    GmModelIdx idx(g1, g2);
-
-    mgm_model.models[idx] = gm_model;
+    mgm_model.add_model(gm_model);
+    gm_model->freeze();
 
     if (g2 >= mgm_model.no_graphs) {
         mgm_model.no_graphs = g2 + 1;
@@ -28,6 +29,48 @@ void mgm_model_add_model(MgmModel& mgm_model, std::shared_ptr<GmModel> gm_model)
     mgm_model.graphs[g2] = gm_model->graph2;
 }
 
+typedef py::array_t<int, py::array::c_style | py::array::forcecast> IntArray;
+typedef py::array_t<double, py::array::c_style | py::array::forcecast> DoubleArray;
+
+// Splits a (n, 2) array into its two columns.
+std::pair<std::vector<int>, std::vector<int>> split_columns(const IntArray& pairs, const std::string& name) {
+    if (pairs.size() == 0) {
+        return {};
+    }
+    if (pairs.ndim() != 2 || pairs.shape(1) != 2) {
+        throw std::invalid_argument(name + " must have shape (n, 2).");
+    }
+    auto p = pairs.unchecked<2>();
+    std::vector<int> first(p.shape(0));
+    std::vector<int> second(p.shape(0));
+    for (py::ssize_t i = 0; i < p.shape(0); i++) {
+        first[i]    = p(i, 0);
+        second[i]   = p(i, 1);
+    }
+    return {std::move(first), std::move(second)};
+}
+
+std::vector<double> to_vector(const DoubleArray& values, const std::string& name) {
+    if (values.ndim() != 1) {
+        throw std::invalid_argument(name + " must be one-dimensional.");
+    }
+    return std::vector<double>(values.data(), values.data() + values.size());
+}
+
+std::shared_ptr<GmModel> gm_model_from_arrays(Graph g1, Graph g2, 
+                                                const IntArray& assignments, const DoubleArray& unary_costs, 
+                                                const IntArray& edges, const DoubleArray& pairwise_costs) {
+    GmModelBuilder builder(g1, g2);
+
+    auto [nodes1, nodes2] = split_columns(assignments, "assignments");
+    builder.set_assignments(std::move(nodes1), std::move(nodes2), to_vector(unary_costs, "unary_costs"));
+
+    auto [assignments1, assignments2] = split_columns(edges, "edges");
+    builder.set_edges(std::move(assignments1), std::move(assignments2), to_vector(pairwise_costs, "pairwise_costs"));
+
+    return builder.build();
+}
+
 py::list labeling_to_list(const std::vector<int>& labeling) {
     py::list converted_list;
 
@@ -55,6 +98,40 @@ py::dict mgm_solution_to_dict_with_none(const MgmSolution &solution) {
     return converted_labeling;
 }
 
+// Clique i maps graph ids to node ids.
+typedef std::vector<std::map<int, int>> CliqueList;
+
+CliqueList clique_table_to_list(const CliqueTable& table) {
+    CliqueList cliques;
+    cliques.reserve(table.no_cliques);
+    for (const auto& c : table) {
+        cliques.emplace_back(c.begin(), c.end());
+    }
+    return cliques;
+}
+
+CliqueTable clique_list_to_table(const CliqueList& cliques, int no_graphs) {
+    CliqueTable table(no_graphs);
+    for (const auto& c : cliques) {
+        table.add_clique(CliqueTable::Clique(c.begin(), c.end()));
+    }
+    return table;
+}
+
+void mgm_solution_set_cliques(MgmSolution& solution, const CliqueList& cliques) {
+    solution.set_solution(clique_list_to_table(cliques, solution.model->no_graphs));
+}
+
+// component -> bytes
+template <typename T>
+py::dict memory_usage_to_dict(const T& self) {
+    py::dict usage;
+    for (const auto& [component, bytes] : self.memory_usage().components) {
+        usage[py::str(component)] = bytes;
+    }
+    return usage;
+}
+
 PYBIND11_MODULE(_pylibmgm, m)
 {   
     // costs.hpp
@@ -84,6 +161,13 @@ PYBIND11_MODULE(_pylibmgm, m)
         .def("add_edge", py::overload_cast<int, int, int, int, double>(&GmModel::add_edge), "Add an edge via four node ids")
         .def("no_assignments", &GmModel::no_assignments)
         .def("no_edges", &GmModel::no_edges)
+        .def("freeze", &GmModel::freeze, "Compact the costs into their read-only layout. Done automatically on first use.")
+        .def("memory_usage", &memory_usage_to_dict<GmModel>, "Memory in bytes, by component.")
+        .def_static("from_arrays", &gm_model_from_arrays, 
+                    py::arg("graph1"), py::arg("graph2"), 
+                    py::arg("assignments"), py::arg("unary_costs"), 
+                    py::arg("edges"), py::arg("pairwise_costs"),
+                    "Build a model in one go. assignments: (n, 2) node pairs, edges: (m, 2) assignment ids (rows of assignments).")
         .def_readonly("assignment_list", &GmModel::assignment_list)
         .def("costs", [](GmModel& self) { return self.costs.get(); }, py::return_value_policy::reference_internal)
         .def_readwrite("graph1", &GmModel::graph1)
@@ -94,17 +178,59 @@ PYBIND11_MODULE(_pylibmgm, m)
         .def(py::init<>())
         .def_readwrite("no_graphs", &MgmModel::no_graphs)
         .def_readwrite("graphs", &MgmModel::graphs)
-        .def_readwrite("models", &MgmModel::models)    
+        .def_property("models", 
+            [](const MgmModel& self) { return self.models; },
+            [](MgmModel& self, const decltype(MgmModel::models)& models) { 
+                self.models = models; 
+                self.build_model_index(); 
+            })
+        .def("gm_model", &MgmModel::gm_model, "Model between graphs g1 < g2. None, if no model exists. Loads lazy models.")
+        .def("model_keys", &MgmModel::model_keys, "Graph pairs of all models, including lazy models that are not loaded.")
+        .def("is_lazy", &MgmModel::is_lazy)
         .def("create_submodel", &MgmModel::create_submodel)  
         .def("add_model", &mgm_model_add_model)
+        .def("memory_usage", &memory_usage_to_dict<MgmModel>, "Memory in bytes, by component. Sums up all graph matching models.")
+        .attr("__module__") = "pylibmgm";
+
+    py::class_<MgmModelView, MgmModel, std::shared_ptr<MgmModelView>>(m, "MgmModelView")
+        .def(py::init<const MgmModel&, std::vector<int>>(), py::arg("parent"), py::arg("graph_ids"),
+             "Submodel sharing the graph matching models of its parent. Graphs are renumbered to 0..n-1.")
+        .def("global_id", &MgmModelView::global_id)
+        .def("local_id", &MgmModelView::local_id)
+        .def("graph_ids", &MgmModelView::graph_ids)
         .attr("__module__") = "pylibmgm";
 
     // solution.hpp
+    py::class_<DenseLabeling>(m, "DenseLabeling")
+        .def("keys", &DenseLabeling::keys)
+        .def("contains", &DenseLabeling::contains)
+        .def("offset", &DenseLabeling::offset)
+        .def("size", &DenseLabeling::size)
+        .def("labels", [](const DenseLabeling& self) { return IntArray(self.labels().size(), self.labels().data()); },
+             "Copy of all labels. Labels of a graph pair start at offset(key).")
+        .def("to_dict", &DenseLabeling::to_labeling)
+        .attr("__module__") = "pylibmgm";
+
+    // energy_delta.hpp
+    py::class_<EnergyDelta>(m, "EnergyDelta")
+        .def("swap", py::overload_cast<int, int, const std::vector<int>&>(&EnergyDelta::swap), 
+             py::arg("clique_A"), py::arg("clique_B"), py::arg("graph_ids"), 
+             "Energy change of exchanging the nodes of the given graphs between two cliques.")
+        .def("move", py::overload_cast<int, int, int>(&EnergyDelta::move), 
+             py::arg("graph_id"), py::arg("clique_A"), py::arg("clique_B"), 
+             "Energy change of moving the node of a graph from clique A to clique B.")
+        .def_static("graph_energy", [](std::shared_ptr<MgmModel> model, const CliqueList& cliques, int graph_id) { 
+                return EnergyDelta::graph_energy(*model, clique_list_to_table(cliques, model->no_graphs), graph_id); 
+            }, py::arg("model"), py::arg("clique_table"), py::arg("graph_id"),
+            "Energy of all models containing the graph. Full evaluation of the graph, not a delta.")
+        .attr("__module__") = "pylibmgm";
+
     py::class_<GmSolution>(m, "GmSolution")
         .def(py::init<>())
         .def(py::init<std::shared_ptr<GmModel>>())
         .def(py::init<std::shared_ptr<GmModel>, std::vector<int>>())
         .def_static("evaluate_static", py::overload_cast<const GmModel&, const std::vector<int>& >(&GmSolution::evaluate))
+        .def_static("evaluate_reference_static", &GmSolution::evaluate_reference, "Scans all edges. Reference for evaluate_static.")
         .def("evaluate", py::overload_cast<>(&GmSolution::evaluate, py::const_))
         .def("to_list_with_none", &gm_solution_to_list_with_none)
         .def("labeling", py::overload_cast<>(&GmSolution::labeling))
@@ -122,19 +248,29 @@ PYBIND11_MODULE(_pylibmgm, m)
         .def(py::init<std::shared_ptr<MgmModel>>())
         .def("evaluate", py::overload_cast<>(&MgmSolution::evaluate, py::const_))
         .def("evaluate", py::overload_cast<int>(&MgmSolution::evaluate, py::const_))
+        .def("evaluate", py::overload_cast<const GmModelIdx&>(&MgmSolution::evaluate, py::const_))
         .def("labeling",        &MgmSolution::labeling, py::return_value_policy::reference)
+        .def("dense_labeling",  &MgmSolution::dense_labeling, py::return_value_policy::copy)
         .def("to_dict_with_none", &mgm_solution_to_dict_with_none)
         .def("set_solution", py::overload_cast<const Labeling&>(&MgmSolution::set_solution))
+        .def("set_solution", py::overload_cast<const DenseLabeling&>(&MgmSolution::set_solution))
         .def("set_solution", py::overload_cast<const GmModelIdx& , std::vector<int> >(&MgmSolution::set_solution))
         .def("set_solution", py::overload_cast<const GmSolution&>(&MgmSolution::set_solution))
+        .def("set_solution", &mgm_solution_set_cliques, "Sets the solution from a list of cliques, see clique_table().")
+        .def("clique_table", [](const MgmSolution& self) { return clique_table_to_list(self.clique_table()); },
+             "Copy of the clique table. Clique i maps graph ids to node ids.")
+        .def("energy_delta", &MgmSolution::energy_delta, py::keep_alive<0, 1>(), 
+             "Energy changes of clique moves on clique_table(). Valid until the solution changes.")
         .def("create_empty_labeling", &MgmSolution::create_empty_labeling)
+        .def("memory_usage", &memory_usage_to_dict<MgmSolution>, "Memory in bytes, by component.")
         .def_readwrite("model", &MgmSolution::model)
+        .def_readwrite_static("evaluation_threads", &MgmSolution::evaluation_threads, "Threads used by evaluate(). 0: OpenMP default.")
         .def("__getitem__", py::overload_cast<GmModelIdx>(&MgmSolution::operator[], py::const_),
                             py::return_value_policy::reference)
         .def("__setitem__", [](MgmSolution &self, const GmModelIdx& index, std::vector<int> labeling)
                             { self.set_solution(index, labeling);})
         .def("__len__", [](const MgmSolution &self) 
-                            { return self.labeling().size(); })
+                            { return self.dense_labeling().keys().size(); })
         .attr("__module__") = "pylibmgm";
 
     // solver_generator_mgm.hpp
@@ -187,6 +323,7 @@ PYBIND11_MODULE(_pylibmgm, m)
             py::arg("greedy_generations") = 10)
         .def("run", &QAPSolver::run,
             py::arg("verbose") = false)
+        .def("memory_usage", &memory_usage_to_dict<QAPSolver>, "Memory in bytes, by component.")
         .attr("__module__") = "pylibmgm";
     
     // lap_interface.hpp
@@ -222,12 +222,13 @@ def solve_mgm_pairwise(mgm_model):
     # Solve pairwise graph matchings
     solution = lib.MgmSolution(mgm_model)
 
-    indices = sorted(mgm_model.models.keys())
+    # model_keys() and gm_model() include lazy models that are not loaded yet.
+    indices = sorted(mgm_model.model_keys())
     total = len(indices)
     interval = total / 5
     i = 0
     for gm_idx in indices:
-        model = mgm_model.models[gm_idx]
+        model = mgm_model.gm_model(*gm_idx)
         
         s = solve_gm(model)
         solution.set_solution(s)
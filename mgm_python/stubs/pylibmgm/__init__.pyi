@@ -1,9 +1,10 @@
 from __future__ import annotations
 import pylibmgm
 from pylibmgm import build_sync_problem
+import numpy
 import typing
 
-__all__ = ['CostMap', 'GMLocalSearcher', 'GMLocalSearcherParallel', 'GmModel', 'GmSolution', 'Graph', 'LAPSolver', 'MgmGenerator', 'MgmModel', 'MgmSolution', 'ParallelGenerator', 'QAPSolver', 'SequentialGenerator', 'SwapLocalSearcher', 'build_sync_problem', 'omp_set_num_threads']
+__all__ = ['CostMap', 'DenseLabeling', 'EnergyDelta', 'GMLocalSearcher', 'GMLocalSearcherParallel', 'GmModel', 'GmSolution', 'Graph', 'LAPSolver', 'MgmGenerator', 'MgmModel', 'MgmModelView', 'MgmSolution', 'ParallelGenerator', 'QAPSolver', 'SequentialGenerator', 'SwapLocalSearcher', 'build_sync_problem', 'omp_set_num_threads']
 
 class CostMap:
     @typing.overload
@@ -67,6 +68,19 @@ class GmModel:
         """
     def costs(self: pylibmgm.GmModel) -> CostMap:
         ...
+    def freeze(self: pylibmgm.GmModel) -> None:
+        """
+        Compact the costs into their read-only layout. Done automatically on first use.
+        """
+    @staticmethod
+    def from_arrays(graph1: Graph, graph2: Graph, assignments: numpy.ndarray, unary_costs: numpy.ndarray, edges: numpy.ndarray, pairwise_costs: numpy.ndarray) -> GmModel:
+        """
+        Build a model in one go. assignments: (n, 2) node pairs, edges: (m, 2) assignment ids (rows of assignments).
+        """
+    def memory_usage(self: pylibmgm.GmModel) -> dict[str, int]:
+        """
+        Memory in bytes, by component.
+        """
     def no_assignments(self: pylibmgm.GmModel) -> int:
         ...
     def no_edges(self: pylibmgm.GmModel) -> int:
@@ -74,8 +88,39 @@ class GmModel:
     @property
     def assignment_list(self) -> list[tuple[int, int]]:
         ...
+class DenseLabeling:
+    def contains(self: pylibmgm.DenseLabeling, arg0: tuple[int, int]) -> bool:
+        ...
+    def keys(self: pylibmgm.DenseLabeling) -> list[tuple[int, int]]:
+        ...
+    def labels(self: pylibmgm.DenseLabeling) -> numpy.ndarray[numpy.int32]:
+        """
+        Copy of all labels. Labels of a graph pair start at offset(key).
+        """
+    def offset(self: pylibmgm.DenseLabeling, arg0: tuple[int, int]) -> int:
+        ...
+    def size(self: pylibmgm.DenseLabeling, arg0: tuple[int, int]) -> int:
+        ...
+    def to_dict(self: pylibmgm.DenseLabeling) -> dict[tuple[int, int], list[int]]:
+        ...
+class EnergyDelta:
+    def graph_energy(self: pylibmgm.EnergyDelta, arg0: int) -> float:
+        ...
+    def move(self: pylibmgm.EnergyDelta, graph_id: int, clique_A: int, clique_B: int) -> float:
+        """
+        Energy change of moving the node of a graph from clique A to clique B.
+        """
+    def swap(self: pylibmgm.EnergyDelta, clique_A: int, clique_B: int, graph_ids: list[int]) -> float:
+        """
+        Energy change of exchanging the nodes of the given graphs between two cliques.
+        """
 class GmSolution:
     @staticmethod
+    def evaluate_reference_static(arg0: GmModel, arg1: list[int]) -> float:
+        """
+        Scans all edges. Reference for evaluate_static.
+        """
+    @staticmethod
     def evaluate_static(arg0: GmModel, arg1: list[int]) -> float:
         ...
     def __getitem__(self: pylibmgm.GmSolution, arg0: int) -> int:
@@ -157,7 +202,33 @@ class MgmModel:
         ...
     def create_submodel(self: pylibmgm.MgmModel, arg0: list[int]) -> pylibmgm.MgmModel:
         ...
+    def gm_model(self: pylibmgm.MgmModel, arg0: int, arg1: int) -> GmModel:
+        """
+        Model between graphs g1 < g2. None, if no model exists. Loads lazy models.
+        """
+    def is_lazy(self: pylibmgm.MgmModel) -> bool:
+        ...
+    def memory_usage(self: pylibmgm.MgmModel) -> dict[str, int]:
+        """
+        Memory in bytes, by component. Sums up all graph matching models.
+        """
+    def model_keys(self: pylibmgm.MgmModel) -> list[tuple[int, int]]:
+        """
+        Graph pairs of all models, including lazy models that are not loaded.
+        """
+class MgmModelView(MgmModel):
+    def __init__(self: pylibmgm.MgmModelView, parent: MgmModel, graph_ids: list[int]) -> None:
+        """
+        Submodel sharing the graph matching models of its parent. Graphs are renumbered to 0..n-1.
+        """
+    def global_id(self: pylibmgm.MgmModelView, arg0: int) -> int:
+        ...
+    def graph_ids(self: pylibmgm.MgmModelView) -> list[int]:
+        ...
+    def local_id(self: pylibmgm.MgmModelView, arg0: int) -> int:
+        ...
 class MgmSolution:
+    evaluation_threads: typing.ClassVar[int]  # value = 0
     model: MgmModel
     def __getitem__(self: pylibmgm.MgmSolution, arg0: tuple[int, int]) -> list[int]:
         ...
@@ -167,6 +238,10 @@ class MgmSolution:
         ...
     def __setitem__(self: pylibmgm.MgmSolution, arg0: tuple[int, int], arg1: list[int]) -> None:
         ...
+    def clique_table(self: pylibmgm.MgmSolution) -> list[dict[int, int]]:
+        """
+        Copy of the clique table. Clique i maps graph ids to node ids.
+        """
     def create_empty_labeling(self: pylibmgm.MgmSolution) -> dict[tuple[int, int], list[int]]:
         ...
     @typing.overload
@@ -175,17 +250,38 @@ class MgmSolution:
     @typing.overload
     def evaluate(self: pylibmgm.MgmSolution, arg0: int) -> float:
         ...
+    @typing.overload
+    def evaluate(self: pylibmgm.MgmSolution, arg0: tuple[int, int]) -> float:
+        ...
+    def dense_labeling(self: pylibmgm.MgmSolution) -> DenseLabeling:
+        ...
+    def energy_delta(self: pylibmgm.MgmSolution) -> EnergyDelta:
+        """
+        Energy changes of clique moves on clique_table(). Valid until the solution changes.
+        """
     def labeling(self: pylibmgm.MgmSolution) -> dict[tuple[int, int], list[int]]:
         ...
+    def memory_usage(self: pylibmgm.MgmSolution) -> dict[str, int]:
+        """
+        Memory in bytes, by component.
+        """
     @typing.overload
     def set_solution(self: pylibmgm.MgmSolution, arg0: dict[tuple[int, int], list[int]]) -> None:
         ...
     @typing.overload
+    def set_solution(self: pylibmgm.MgmSolution, arg0: DenseLabeling) -> None:
+        ...
+    @typing.overload
     def set_solution(self: pylibmgm.MgmSolution, arg0: tuple[int, int], arg1: list[int]) -> None:
         ...
     @typing.overload
     def set_solution(self: pylibmgm.MgmSolution, arg0: GmSolution) -> None:
         ...
+    @typing.overload
+    def set_solution(self: pylibmgm.MgmSolution, arg0: list[dict[int, int]]) -> None:
+        """
+        Sets the solution from a list of cliques, see clique_table().
+        """
     def to_dict_with_none(self: pylibmgm.MgmSolution) -> dict:
         ...
 class ParallelGenerator(MgmGenerator):
@@ -198,6 +294,10 @@ class ParallelGenerator(MgmGenerator):
 class QAPSolver:
     def __init__(self: pylibmgm.QAPSolver, model: GmModel, batch_size: int = 10, greedy_generations: int = 10) -> None:
         ...
+    def memory_usage(self: pylibmgm.QAPSolver) -> dict[str, int]:
+        """
+        Memory in bytes, by component.
+        """
     def run(self: pylibmgm.QAPSolver, verbose: bool = False) -> GmSolution:
         ...
 class SequentialGenerator(MgmGenerator):
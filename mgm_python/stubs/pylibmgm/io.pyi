@@ -2,7 +2,10 @@ from __future__ import annotations
 import os
 import pylibmgm
 import typing
-__all__ = ['export_dd_file', 'import_solution', 'parse_dd_file', 'parse_dd_file_gm', 'save_to_disk']
+__all__ = ['export_binary', 'export_dd_file', 'import_solution', 'open_lazy', 'parse_binary', 'parse_dd_file', 'parse_dd_file_gm', 'save_binary_solution', 'save_clique_table', 'save_to_disk']
+
+def export_binary(arg0: os.PathLike, arg1: pylibmgm.MgmModel) -> None:
+    ...
 
 def export_dd_file(arg0: os.PathLike, arg1: pylibmgm.MgmModel) -> None:
     ...
@@ -10,14 +13,26 @@ def export_dd_file(arg0: os.PathLike, arg1: pylibmgm.MgmModel) -> None:
 def import_solution(arg0: os.PathLike, arg1: pylibmgm.MgmModel) -> pylibmgm.MgmSolution:
     ...
 
+def open_lazy(model_file: os.PathLike, memory_budget: int = 0, unary_constant: float = 0.0) -> pylibmgm.MgmModel:
+    ...
+
+def parse_binary(mgmb_file: os.PathLike, unary_constant: float = 0.0) -> pylibmgm.MgmModel:
+    ...
+
 def parse_dd_file(dd_file: os.PathLike, unary_constant: float = 0.0) -> pylibmgm.MgmModel:
     ...
 
 def parse_dd_file_gm(gm_dd_file: os.PathLike, unary_constant: float = 0.0) -> pylibmgm.GmModel:
     ...
 
+def save_binary_solution(filepath: os.PathLike, solution: pylibmgm.MgmSolution, compute_energy: bool = True) -> None:
+    ...
+
+def save_clique_table(filepath: os.PathLike, solution: pylibmgm.MgmSolution, compute_energy: bool = True) -> None:
+    ...
+
 @typing.overload
-def save_to_disk(filepath: os.PathLike, solution: pylibmgm.MgmSolution) -> None:
+def save_to_disk(filepath: os.PathLike, solution: pylibmgm.MgmSolution, compute_energy: bool = True) -> None:
     ...
 
 @typing.overload
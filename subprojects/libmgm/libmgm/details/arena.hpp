@@ -0,0 +1,104 @@
+#ifndef LIBMGM_ARENA_HPP
+#define LIBMGM_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace mgm {
+
+// Monotonic arena for the data of the GmModels parsed into it, e.g. all models parsed by one thread.
+// Allocations are carved out of a few large blocks, which are released at once when the arena is destroyed.
+// Every model keeps its arena alive, so the blocks are freed with the last model.
+//
+// An arena is filled in two phases:
+//  - While building, allocations come from the blocks and deallocation is a no-op. Not thread safe,
+//    so an arena is only ever built by one thread at a time.
+//  - Once sealed, allocations come from the heap and are freed normally. Memory of the blocks is never reused.
+//    Thawing a model or building its incidence layout later therefore doesn't grow the arena,
+//    and models sharing a sealed arena can allocate concurrently.
+class ModelArena : public std::pmr::memory_resource {
+    public:
+        explicit ModelArena(size_t initial_size = 1 << 20) : upstream(), buffer(initial_size, &upstream) {};
+
+        ModelArena(const ModelArena&) = delete;
+        ModelArena& operator=(const ModelArena&) = delete;
+
+        // Ends the building phase. Needs to happen before the models are shared with other threads.
+        void seal() { this->sealed = true; }
+        bool is_sealed() const { return this->sealed; }
+
+        // Bytes of all blocks obtained from the heap.
+        size_t reserved_bytes() const { return this->upstream.bytes; }
+
+        // Bytes handed out of the blocks, including memory of containers that have since been reallocated.
+        size_t allocated_bytes() const { return this->allocated; }
+
+    private:
+        // Counts and records the blocks requested by the monotonic buffer.
+        // Blocks are kept sorted by address, so that finding the block of a pointer is a binary search.
+        struct BlockResource : public std::pmr::memory_resource {
+            size_t bytes = 0;
+            std::vector<std::pair<std::uintptr_t, std::uintptr_t>> blocks; // [begin, end), sorted by begin
+
+            bool contains(const void* p) const {
+                auto address = reinterpret_cast<std::uintptr_t>(p);
+                // First block beginning after p. p lies in the block before, if in any.
+                auto it = std::upper_bound(this->blocks.begin(), this->blocks.end(), address, 
+                                            [](std::uintptr_t a, const auto& block) { return a < block.first; });
+                return it != this->blocks.begin() && address < std::prev(it)->second;
+            }
+
+            void* do_allocate(size_t bytes, size_t alignment) override {
+                void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+                auto begin = reinterpret_cast<std::uintptr_t>(p);
+                auto block = std::make_pair(begin, begin + bytes);
+                this->blocks.insert(std::upper_bound(this->blocks.begin(), this->blocks.end(), block), block);
+                this->bytes += bytes;
+                return p;
+            }
+            void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+                std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+                auto begin = reinterpret_cast<std::uintptr_t>(p);
+                auto it = std::lower_bound(this->blocks.begin(), this->blocks.end(), std::make_pair(begin, std::uintptr_t(0)));
+                if (it != this->blocks.end() && it->first == begin) {
+                    this->blocks.erase(it);
+                }
+                this->bytes -= bytes;
+            }
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                return this == &other;
+            }
+        };
+
+        BlockResource upstream;
+        std::pmr::monotonic_buffer_resource buffer;
+        size_t allocated = 0;
+        bool sealed = false;
+
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            if (this->sealed) {
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+            this->allocated += bytes;
+            return this->buffer.allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+            // Memory of the blocks is released with the arena.
+            if (!this->upstream.contains(p)) {
+                std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            }
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+};
+
+}
+#endif
@@ -138,4 +138,27 @@ void CliqueManager::prune()
     this->cliques.prune();
     this->build_clique_idx_view();
 }
+
+MemoryUsage CliqueTable::memory_usage() const {
+    size_t bytes = details::vector_bytes(this->cliques);
+    for (const auto& c : this->cliques) {
+        bytes += details::dense_map_bytes(c);
+    }
+    MemoryUsage usage;
+    usage.add("cliques", bytes);
+    return usage;
+}
+
+MemoryUsage CliqueManager::memory_usage() const {
+    size_t view_bytes = details::node_map_bytes(this->clique_idx_view);
+    for (const auto& [graph_id, idx] : this->clique_idx_view) {
+        view_bytes += details::vector_bytes(idx);
+    }
+
+    MemoryUsage usage;
+    usage.add("clique_table", this->cliques.memory_usage());
+    usage.add("clique_idx_view", view_bytes);
+    usage.add("graph_ids", details::vector_bytes(this->graph_ids));
+    return usage;
+}
 }
\ No newline at end of file
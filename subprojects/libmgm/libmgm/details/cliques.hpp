@@ -5,6 +5,7 @@
 #include <vector>
 #include <ankerl/unordered_dense.h>
 
+#include "memory_usage.hpp"
 #include "multigraph.hpp"
 
 namespace mgm {
@@ -38,6 +39,8 @@ class CliqueTable {
         void remove_graph(int graph_id, bool should_prune=true);
         void prune();
 
+        MemoryUsage memory_usage() const;
+
     private:
         std::vector<Clique> cliques;
         Clique empty_clique;
@@ -60,6 +63,8 @@ class CliqueManager {
         void build_clique_idx_view();
         void remove_graph(int graph_id, bool should_prune=true);
         void prune();
+
+        MemoryUsage memory_usage() const;
         
     private:
         int& clique_idx(int graph_id, int node_id);
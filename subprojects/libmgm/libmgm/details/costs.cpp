@@ -2,34 +2,82 @@
 #include <unordered_map>
 #include <string>
 #include <algorithm>
+#include <numeric>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
 
 #include "costs.hpp"
 
 namespace mgm {
     
-CostMap::CostMap(int no_unaries, int no_pairwise) {
-    this->assignments.reserve(no_unaries);
+CostMap::CostMap(int no_unaries, int no_pairwise, std::pmr::memory_resource* resource)
+    :
+    assignment_index(0, AssignmentIdxHash(), std::equal_to<AssignmentIdx>(), resource),
+    unaries(resource),
+    edges(0, EdgeKeyHash(), std::equal_to<EdgeKey>(), resource),
+    edges_csr(resource),
+    incidence_csr(resource),
+    ids_dense(resource),
+    unaries_dense(resource)
+    {
+    this->assignment_index.reserve(no_unaries);
+    this->unaries.reserve(no_unaries);
     this->edges.reserve(no_pairwise);
 }
 
-const double& CostMap::unary(int node1, int node2) const{
+double CostMap::unary(int node1, int node2) const{
     return this->unary(AssignmentIdx(node1, node2));
 }
 
-const double& CostMap::unary(AssignmentIdx assignment) const{
-    return this->assignments.at(assignment);
+double CostMap::unary(AssignmentIdx assignment) const{
+    if (this->has_dense_index()) {
+        double cost = this->unary_or(assignment, std::numeric_limits<double>::quiet_NaN());
+        if (std::isnan(cost)) {
+            throw std::out_of_range("Assignment not contained in cost map.");
+        }
+        return cost;
+    }
+    int id = this->assignment_id(assignment);
+    if (id < 0) {
+        throw std::out_of_range("Assignment not contained in cost map.");
+    }
+    return this->unaries[id];
+}
+
+double CostMap::unary_or(AssignmentIdx assignment, double fallback) const {
+    if (this->has_dense_index()) {
+        // Single load, missing assignments hold NaN.
+        auto [node1, node2] = assignment;
+        if (node1 < 0 || node1 >= this->dense_rows || node2 < 0 || node2 >= this->dense_cols) {
+            return fallback;
+        }
+        double cost = this->unaries_dense[(size_t) node1 * this->dense_cols + node2];
+        return std::isnan(cost) ? fallback : cost;
+    }
+    int id = this->assignment_id(assignment);
+    return (id >= 0) ? this->unaries[id] : fallback;
 }
 
-const double& CostMap::pairwise(int node1, int node2, int node3, int node4) const {
+double CostMap::pairwise(int node1, int node2, int node3, int node4) const {
     AssignmentIdx a1 = AssignmentIdx(node1, node2);
     AssignmentIdx a2 = AssignmentIdx(node3, node4);
 
     return this->pairwise(EdgeIdx(a1, a2));
 }
 
-const double& CostMap::pairwise(EdgeIdx edge) const{
-    EdgeIdx e = this->sort_edge_indices(edge);
-    return this->edges.at(e);
+double CostMap::pairwise(EdgeIdx edge) const{
+    int a1 = this->assignment_id(edge.first);
+    int a2 = this->assignment_id(edge.second);
+    if (a1 < 0 || a2 < 0) {
+        throw std::out_of_range("Edge not contained in cost map.");
+    }
+    const CostValue* cost = this->find_edge(a1, a2);
+    if (cost == nullptr) {
+        throw std::out_of_range("Edge not contained in cost map.");
+    }
+    return *cost;
 }
 
 bool CostMap::contains (int node1, int node2) const {
@@ -37,7 +85,7 @@ bool CostMap::contains (int node1, int node2) const {
 }
 
 bool CostMap::contains (AssignmentIdx assignment) const {
-    return this->assignments.find(assignment) != this->assignments.end();
+    return this->assignment_id(assignment) >= 0;
 }
 
 bool CostMap::contains (int node1, int node2, int node3, int node4) const {
@@ -48,28 +96,406 @@ bool CostMap::contains (int node1, int node2, int node3, int node4) const {
 }
 
 bool CostMap::contains (EdgeIdx edge) const {
-    EdgeIdx e = this->sort_edge_indices(edge);
-    return this->edges.find(e) != this->edges.end();
+    int a1 = this->assignment_id(edge.first);
+    int a2 = this->assignment_id(edge.second);
+    if (a1 < 0 || a2 < 0) {
+        return false;
+    }
+    return this->find_edge(a1, a2) != nullptr;
 }
 
 void CostMap::set_unary(int node1, int node2, double cost) {
-    this->assignments[AssignmentIdx(node1, node2)] = cost;
+    if (std::isnan(cost)) {
+        // NaN marks missing assignments in the dense layout.
+        throw std::invalid_argument("Can't set unary cost. Cost is NaN.");
+    }
+    int id = this->assignment_id(node1, node2);
+    if (id >= 0) {
+        // Same layout, so this is fine on a frozen cost map as well.
+        this->unaries[id] = cost;
+        if (this->has_dense_index()) {
+            this->unaries_dense[(size_t) node1 * this->dense_cols + node2] = cost;
+        }
+        return;
+    }
+    if (this->owned_by_model) {
+        // Assignment ids are positions in GmModel::assignment_list.
+        throw std::logic_error("Can't add assignment to the cost map of a GmModel. Use GmModel::add_assignment.");
+    }
+    this->add_unary(node1, node2, cost);
+}
+
+void CostMap::add_unary(int node1, int node2, double cost) {
+    if (this->frozen) {
+        // Frozen edges and the dense index would go stale.
+        throw std::logic_error("Can't add assignment. Cost map is frozen, thaw first.");
+    }
+    if (std::isnan(cost)) {
+        throw std::invalid_argument("Can't set unary cost. Cost is NaN.");
+    }
+    AssignmentIdx a(node1, node2);
+    auto [it, inserted] = this->assignment_index.emplace(a, static_cast<int>(this->unaries.size()));
+    if (!inserted) {
+        this->unaries[it->second] = cost;
+        return;
+    }
+    this->unaries.push_back(cost);
 }
 
 void CostMap::set_pairwise(int node1, int node2, int node3, int node4, double cost) {
-    AssignmentIdx a1 = AssignmentIdx(node1, node2);
-    AssignmentIdx a2 = AssignmentIdx(node3, node4);
+    int a1 = this->assignment_id(node1, node2);
+    int a2 = this->assignment_id(node3, node4);
+    if (a1 < 0 || a2 < 0) {
+        throw std::invalid_argument("Can't add edge. Assignments have to be added before their edges.");
+    }
+    this->set_pairwise(a1, a2, cost);
+}
+
+void CostMap::set_pairwise(int assignment1, int assignment2, double cost) {
+    if (assignment1 < 0 || assignment1 >= this->no_assignments() ||
+        assignment2 < 0 || assignment2 >= this->no_assignments()) {
+        throw std::out_of_range("Can't add edge. Assignment id out of range.");
+    }
+    EdgeKey key = edge_key(assignment1, assignment2);
+    if (!this->frozen) {
+        this->edges[key] = cost;
+        return;
+    }
+
+    // Existing edges are updated in the frozen layout and, if built, in both rows of the incidence.
+    CostValue* csr_cost = find_in_row(this->edges_csr, key.first, key.second);
+    if (csr_cost == nullptr) {
+        throw std::logic_error("Can't add edge. Cost map is frozen, thaw first.");
+    }
+    *csr_cost = cost;
+    if (this->incidence_csr.no_rows() == this->edges_csr.no_rows()) {
+        *find_in_row(this->incidence_csr, key.first, key.second) = cost;
+        *find_in_row(this->incidence_csr, key.second, key.first) = cost;
+    }
+}
+
+std::vector<AssignmentIdx> CostMap::assignments() const {
+    std::vector<AssignmentIdx> assignments(this->unaries.size());
+    if (this->has_dense_index()) {
+        for (int node1 = 0; node1 < this->dense_rows; node1++) {
+            for (int node2 = 0; node2 < this->dense_cols; node2++) {
+                int id = this->ids_dense[(size_t) node1 * this->dense_cols + node2];
+                if (id >= 0)
+                    assignments[id] = AssignmentIdx(node1, node2);
+            }
+        }
+        return assignments;
+    }
+    for (const auto& [a, id] : this->assignment_index) {
+        assignments[id] = a;
+    }
+    return assignments;
+}
+
+int CostMap::assignment_id(int node1, int node2) const {
+    if (this->has_dense_index()) {
+        if (node1 < 0 || node1 >= this->dense_rows || node2 < 0 || node2 >= this->dense_cols) {
+            return -1;
+        }
+        return this->ids_dense[(size_t) node1 * this->dense_cols + node2];
+    }
+    auto it = this->assignment_index.find(AssignmentIdx(node1, node2));
+    return (it != this->assignment_index.end()) ? it->second : -1;
+}
+
+int CostMap::assignment_id(AssignmentIdx assignment) const {
+    return this->assignment_id(assignment.first, assignment.second);
+}
+
+double CostMap::pairwise_or(int assignment1, int assignment2, double fallback) const {
+    if (assignment1 < 0 || assignment2 < 0) {
+        return fallback;
+    }
+    const CostValue* cost = this->find_edge(assignment1, assignment2);
+    return (cost != nullptr) ? *cost : fallback;
+}
+
+const CostValue* CostMap::find_edge(int assignment1, int assignment2) const {
+    EdgeKey key = edge_key(assignment1, assignment2);
+    if (!this->frozen) {
+        auto it = this->edges.find(key);
+        return (it != this->edges.end()) ? &it->second : nullptr;
+    }
+    return find_in_row(this->edges_csr, key.first, key.second);
+}
+
+template <typename CSR>
+auto CostMap::find_in_row(CSR& csr, int row, int neighbour) -> decltype(&csr.costs[0]) {
+    if (row >= csr.no_rows()) {
+        return nullptr;
+    }
+    auto first  = csr.neighbours.begin() + csr.offsets[row];
+    auto last   = csr.neighbours.begin() + csr.offsets[row + 1];
+    auto it     = std::lower_bound(first, last, neighbour);
+    if (it == last || *it != neighbour) {
+        return nullptr;
+    }
+    return &csr.costs[it - csr.neighbours.begin()];
+}
+
+void CostMap::freeze(int no_nodes1, int no_nodes2) {
+    if (this->frozen) 
+        return;
+
+    // Dense id matrix
+    this->ids_dense.clear();
+    size_t matrix_size = (size_t) std::max(no_nodes1, 0) * (size_t) std::max(no_nodes2, 0);
+    bool is_dense = (matrix_size > 0) && (this->assignment_index.size() >= dense_unary_threshold * matrix_size);
+    for (const auto& [a, id] : this->assignment_index) {
+        if (!is_dense) 
+            break;
+        if (a.first < 0 || a.first >= no_nodes1 || a.second < 0 || a.second >= no_nodes2) {
+            is_dense = false;
+        }
+    }
+    if (is_dense) {
+        this->dense_rows = no_nodes1;
+        this->dense_cols = no_nodes2;
+        this->ids_dense.assign(matrix_size, -1);
+        for (const auto& [a, id] : this->assignment_index) {
+            this->ids_dense[(size_t) a.first * this->dense_cols + a.second] = id;
+        }
+        this->fill_dense_unaries();
+    }
+
+    auto& csr = this->edges_csr;
+    csr.offsets.assign(this->unaries.size() + 1, 0);
+
+    // First pass: Count row sizes. The row of an edge is its smaller assignment id.
+    for (const auto& [key, cost] : this->edges) {
+        csr.offsets[key.first + 1]++;
+    }
+    std::partial_sum(csr.offsets.begin(), csr.offsets.end(), csr.offsets.begin());
+
+    // Second pass: Fill rows.
+    csr.neighbours.resize(this->edges.size());
+    csr.costs.resize(this->edges.size());
+
+    std::vector<int> row_end(csr.offsets.begin(), csr.offsets.end() - 1);
+    for (const auto& [key, cost] : this->edges) {
+        auto [a1, a2] = key;
+        int pos = row_end[a1]++;
+        csr.neighbours[pos] = a2;
+        csr.costs[pos]      = cost;
+    }
+
+    csr.sort_rows();
+
+    // Lookups of a frozen map go through the CSR rows and, if present, the dense index. thaw() rebuilds the maps.
+    auto* resource = this->unaries.get_allocator().resource();
+    EdgeContainer(0, EdgeKeyHash(), std::equal_to<EdgeKey>(), resource).swap(this->edges);
+    if (is_dense) {
+        AssignmentContainer(0, AssignmentIdxHash(), std::equal_to<AssignmentIdx>(), resource).swap(this->assignment_index);
+    }
+
+    this->frozen = true;
+}
+
+void CostMap::assign_frozen(const std::pmr::vector<AssignmentIdx>& assignments, std::pmr::vector<CostValue> unaries, 
+                            EdgeCSR edges, int no_nodes1, int no_nodes2) {
+    int no_assignments = static_cast<int>(assignments.size());
+    if (static_cast<int>(unaries.size()) != no_assignments) {
+        throw std::invalid_argument("Can't assign costs. Number of unaries differs from number of assignments.");
+    }
+    if (std::any_of(unaries.begin(), unaries.end(), [](CostValue c) { return std::isnan(c); })) {
+        throw std::invalid_argument("Can't assign costs. Unary cost is NaN.");
+    }
+
+    // Edge layout. Rows have to be sorted without duplicates and edges stored in the row of their smaller id.
+    if (edges.no_rows() != no_assignments || edges.offsets.front() != 0 || 
+        edges.neighbours.size() != edges.costs.size() || edges.offsets.back() != static_cast<int>(edges.neighbours.size())) {
+        throw std::invalid_argument("Can't assign costs. Edge layout does not match the assignments.");
+    }
+    for (int a = 0; a < no_assignments; a++) {
+        int begin   = edges.offsets[a];
+        int end     = edges.offsets[a+1];
+        if (end < begin) {
+            throw std::invalid_argument("Can't assign costs. Edge offsets are not ascending.");
+        }
+        for (int i = begin; i < end; i++) {
+            int b = edges.neighbours[i];
+            if (b < a || b >= no_assignments || (i > begin && b <= edges.neighbours[i-1])) {
+                throw std::invalid_argument("Can't assign costs. Invalid or duplicate edge.");
+            }
+        }
+    }
+
+    // Reverse index. Dense, if the same rule as in freeze() applies. A hash map otherwise.
+    this->assignment_index.clear();
+    this->ids_dense.clear();
+    size_t matrix_size = (size_t) std::max(no_nodes1, 0) * (size_t) std::max(no_nodes2, 0);
+    bool is_dense = (matrix_size > 0) && (assignments.size() >= dense_unary_threshold * matrix_size);
+    if (is_dense) {
+        this->dense_rows = no_nodes1;
+        this->dense_cols = no_nodes2;
+        this->ids_dense.assign(matrix_size, -1);
+    }
+    else {
+        this->assignment_index.reserve(assignments.size());
+    }
+    for (int id = 0; id < no_assignments; id++) {
+        const auto& [node1, node2] = assignments[id];
+        if (node1 < 0 || node1 >= no_nodes1 || node2 < 0 || node2 >= no_nodes2) {
+            throw std::out_of_range("Can't assign costs. Node out of range of graph.");
+        }
+        bool inserted;
+        if (is_dense) {
+            int& slot = this->ids_dense[(size_t) node1 * this->dense_cols + node2];
+            inserted = (slot < 0);
+            slot = id;
+        }
+        else {
+            inserted = this->assignment_index.emplace(assignments[id], id).second;
+        }
+        if (!inserted) {
+            throw std::invalid_argument("Can't assign costs. Assignment already exists.");
+        }
+    }
+
+    this->unaries       = std::move(unaries);
+    if (is_dense) {
+        this->fill_dense_unaries();
+    }
+    this->edges.clear();
+    this->edges_csr     = std::move(edges);
+    this->incidence_csr = EdgeCSR(this->unaries.get_allocator().resource());
+    this->frozen        = true;
+}
+
+void CostMap::build_incidence() {
+    assert(this->frozen);
+    const auto& csr = this->edges_csr;
+    auto& inc = this->incidence_csr;
+
+    inc.offsets.assign(csr.offsets.size(), 0);
+    for (int a = 0; a < csr.no_rows(); a++) {
+        for (int i = csr.offsets[a]; i < csr.offsets[a+1]; i++) {
+            inc.offsets[a + 1]++;
+            if (csr.neighbours[i] != a)
+                inc.offsets[csr.neighbours[i] + 1]++;
+        }
+    }
+    std::partial_sum(inc.offsets.begin(), inc.offsets.end(), inc.offsets.begin());
+
+    inc.neighbours.resize(inc.offsets.back());
+    inc.costs.resize(inc.offsets.back());
+
+    // Rows are visited in ascending order and are sorted themselves.
+    // Every row of the incidence therefore receives its neighbours in ascending order, no sorting needed.
+    std::vector<int> row_end(inc.offsets.begin(), inc.offsets.end() - 1);
+    for (int a = 0; a < csr.no_rows(); a++) {
+        for (int i = csr.offsets[a]; i < csr.offsets[a+1]; i++) {
+            int b = csr.neighbours[i];
+
+            int pos = row_end[a]++;
+            inc.neighbours[pos] = b;
+            inc.costs[pos]      = csr.costs[i];
+
+            if (b == a)
+                continue;
+            pos = row_end[b]++;
+            inc.neighbours[pos] = a;
+            inc.costs[pos]      = csr.costs[i];
+        }
+    }
+}
+
+void CostMap::thaw() {
+    // Hash maps skipped by assign_frozen() are needed again.
+    if (this->has_dense_index() && this->assignment_index.size() != this->unaries.size()) {
+        this->assignment_index.reserve(this->unaries.size());
+        for (int node1 = 0; node1 < this->dense_rows; node1++) {
+            for (int node2 = 0; node2 < this->dense_cols; node2++) {
+                int id = this->ids_dense[(size_t) node1 * this->dense_cols + node2];
+                if (id >= 0) 
+                    this->assignment_index.emplace(AssignmentIdx(node1, node2), id);
+            }
+        }
+    }
+    if (this->frozen && this->edges.size() != this->edges_csr.neighbours.size()) {
+        this->edges.reserve(this->edges_csr.neighbours.size());
+        this->for_each_edge([this](EdgeKey key, CostValue cost) { this->edges.emplace(key, cost); });
+    }
+
+    // Keeps the memory resource of this cost map.
+    this->edges_csr = EdgeCSR(this->unaries.get_allocator().resource());
+    this->incidence_csr = EdgeCSR(this->unaries.get_allocator().resource());
+    this->ids_dense = std::pmr::vector<int>(this->unaries.get_allocator().resource());
+    this->unaries_dense = std::pmr::vector<CostValue>(this->unaries.get_allocator().resource());
+    this->frozen = false;
+}
+
+void CostMap::fill_dense_unaries() {
+    this->unaries_dense.assign(this->ids_dense.size(), std::numeric_limits<CostValue>::quiet_NaN());
+    for (size_t i = 0; i < this->ids_dense.size(); i++) {
+        int id = this->ids_dense[i];
+        if (id >= 0)
+            this->unaries_dense[i] = this->unaries[id];
+    }
+}
+
+void EdgeCSR::sort_rows() {
+    std::vector<std::pair<int, CostValue>> row;
+    for (int a = 0; a < this->no_rows(); a++) {
+        int begin = this->offsets[a];
+        int end = this->offsets[a+1];
+        if (end - begin < 2)
+            continue;
 
-    EdgeIdx e = this->sort_edge_indices(EdgeIdx(a1, a2));
-    this->edges[e] = cost;
+        row.clear();
+        for (int j = begin; j < end; j++) {
+            row.emplace_back(this->neighbours[j], this->costs[j]);
+        }
+        // Stable, so that repeated edges keep their input order (see merge_duplicates).
+        std::stable_sort(row.begin(), row.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+        for (int j = begin; j < end; j++) {
+            this->neighbours[j] = row[j - begin].first;
+            this->costs[j]      = row[j - begin].second;
+        }
+    }
 }
 
-// FIXME: Measure impact of this.
-EdgeIdx CostMap::sort_edge_indices(EdgeIdx edge) const {
-    if (edge.first.first > edge.second.first) {
-        return EdgeIdx(edge.second, edge.first);
+void EdgeCSR::merge_duplicates() {
+    int pos = 0;
+    int begin = 0;
+    for (int a = 0; a < this->no_rows(); a++) {
+        int end = this->offsets[a+1];
+        int row_start = pos;
+        for (int j = begin; j < end; j++) {
+            if (pos > row_start && this->neighbours[pos-1] == this->neighbours[j]) {
+                this->costs[pos-1] = this->costs[j];
+                continue;
+            }
+            this->neighbours[pos] = this->neighbours[j];
+            this->costs[pos]      = this->costs[j];
+            pos++;
+        }
+        begin = end;
+        this->offsets[a+1] = pos;
     }
-    return edge;
+    this->neighbours.resize(pos);
+    this->costs.resize(pos);
+}
+
+MemoryUsage CostMap::memory_usage() const {
+    auto csr_bytes = [](const EdgeCSR& csr) {
+        return details::vector_bytes(csr.offsets) + details::vector_bytes(csr.neighbours) + details::vector_bytes(csr.costs);
+    };
+
+    MemoryUsage usage;
+    usage.add("assignment_index",   details::dense_map_bytes(this->assignment_index));
+    usage.add("unaries",            details::vector_bytes(this->unaries));
+    usage.add("edges",              details::dense_map_bytes(this->edges));
+    usage.add("edges_csr",          csr_bytes(this->edges_csr));
+    usage.add("incidence",          csr_bytes(this->incidence_csr));
+    usage.add("dense_index",        details::vector_bytes(this->ids_dense));
+    usage.add("dense_unaries",      details::vector_bytes(this->unaries_dense));
+    return usage;
 }
 
 void boost_hash_combine(size_t& seed, const int& v) {
@@ -2,17 +2,35 @@
 #define LIBMGM_COSTS_HPP
 
 #include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
 #include <utility>
+#include <vector>
 #include <ankerl/unordered_dense.h>
 
+#include "memory_usage.hpp"
+
 namespace mgm {
+class GmModel;
+
 /*
 * FIXME: Using boost hash combine improved performance drastically. 
 *   However, this could probably be improved with a more specialize Hashtable for large number of entries (number of edges ~500.000).
+*   Solvers that scan all edges should use the frozen CSR layout (see CostMap::freeze) instead.
+*   Internally, edges are keyed by assignment ids (see EdgeKey). EdgeIdx is only used by the node based interface.
 */
 typedef std::pair<int,int> AssignmentIdx;
 typedef std::pair<AssignmentIdx, AssignmentIdx> EdgeIdx;
 
+// Storage type of all costs. Building with -Dfloat_costs=true halves the memory needed per cost value.
+// Sums of costs are always accumulated in double.
+#ifdef LIBMGM_FLOAT_COSTS
+typedef float CostValue;
+#else
+typedef double CostValue;
+#endif
+
 
 void boost_hash_combine(size_t& seed, const int& v);
 
@@ -36,19 +54,56 @@ struct EdgeIdxHash {
     }
 };
 
-typedef ankerl::unordered_dense::map<AssignmentIdx, double, AssignmentIdxHash> AssignmentContainer;
-typedef ankerl::unordered_dense::map<EdgeIdx, double, EdgeIdxHash> EdgeContainer;
+// Edges are keyed by the ids of their two assignments, smaller id first.
+// Two 32 bit ints instead of one uint64, so that float costs pack into 12 byte map entries.
+typedef std::pair<int,int> EdgeKey;
+
+struct EdgeKeyHash {
+    using is_avalanching = void;
+    std::uint64_t operator()(EdgeKey const& input) const noexcept {
+        std::uint64_t hash = static_cast<std::uint32_t>(input.first);
+        hash = (hash << 32) | static_cast<std::uint32_t>(input.second);
+        return ankerl::unordered_dense::detail::wyhash::hash(hash);
+    }
+};
+
+// All containers of a CostMap allocate from a memory resource, e.g. the arena of its GmModel (see ModelArena).
+typedef ankerl::unordered_dense::map<AssignmentIdx, int, AssignmentIdxHash, std::equal_to<AssignmentIdx>, 
+                                    std::pmr::polymorphic_allocator<std::pair<AssignmentIdx, int>>> AssignmentContainer; // Assignment -> assignment id
+typedef ankerl::unordered_dense::map<EdgeKey, CostValue, EdgeKeyHash, std::equal_to<EdgeKey>, 
+                                    std::pmr::polymorphic_allocator<std::pair<EdgeKey, CostValue>>> EdgeContainer;
+
+// Compressed sparse row (CSR) layout of all pairwise costs, indexed by assignment id.
+// Every edge is stored once, in the row of its smaller assignment id. Rows are sorted by neighbour id.
+struct EdgeCSR {
+    explicit EdgeCSR(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) 
+        : offsets(1, 0, resource), neighbours(resource), costs(resource) {};
+
+    std::pmr::vector<int>       offsets;  // Row a spans [offsets[a], offsets[a+1])
+    std::pmr::vector<int>       neighbours;
+    std::pmr::vector<CostValue> costs;
 
+    int no_rows() const { return static_cast<int>(offsets.size()) - 1; }
+
+    // Sorts every row by neighbour id. Repeated neighbours keep their order.
+    void sort_rows();
+
+    // Keeps one entry per neighbour and row, with the cost of the last one. Rows need to be sorted.
+    void merge_duplicates();
+};
+
+// Assignments are numbered by order of insertion. For a GmModel, the assignment id is the position in GmModel::assignment_list.
+// All costs are stored by assignment id. The node based interface resolves ids through a reverse index.
 class CostMap {
     public:
-        CostMap(int no_unaries, int no_pairwise);
+        CostMap(int no_unaries, int no_pairwise, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
         ~CostMap() {};
         
-        const double& unary(int node1, int node2)                           const;
-        const double& unary(AssignmentIdx assignment)                       const;
+        double unary(int node1, int node2)                                  const;
+        double unary(AssignmentIdx assignment)                              const;
         
-        const double& pairwise(int node1, int node2, int node3, int node4)  const;
-        const double& pairwise(EdgeIdx edge)                                const;
+        double pairwise(int node1, int node2, int node3, int node4)         const;
+        double pairwise(EdgeIdx edge)                                       const;
 
         bool contains (int node1, int node2)                                const;
         bool contains (AssignmentIdx assignment)                            const;
@@ -56,11 +111,76 @@ class CostMap {
         bool contains (int node1, int node2, int node3, int node4)          const;
         bool contains (EdgeIdx edge)                                        const;
 
+        // Unary cost or `fallback`, if the assignment does not exist. Needs only one lookup.
+        double unary_or(AssignmentIdx assignment, double fallback)          const;
+
+        // Costs of existing assignments and edges are updated in place, also on a frozen cost map.
+        // New ones throw std::logic_error on a frozen cost map, thaw() first. The cost map of a GmModel only takes
+        // new edges this way. Assignments are added through GmModel::add_assignment, which keeps its assignment_list in sync.
         void set_unary(int node1, int node2, double cost);
         void set_pairwise(int node1, int node2, int node3, int node4, double cost);
 
-        const AssignmentContainer&  all_assignments()   const { return assignments; }
-        const EdgeContainer&        all_edges()         const { return edges; }
+        // Assignment id based interface
+        // Returns -1, if the assignment does not exist.
+        int assignment_id(int node1, int node2)                             const;
+        int assignment_id(AssignmentIdx assignment)                         const;
+
+        // Edge cost or `fallback`, if the edge does not exist. Negative ids are treated as non-existent.
+        double pairwise_or(int assignment1, int assignment2, double fallback) const;
+        void set_pairwise(int assignment1, int assignment2, double cost);
+
+        static EdgeKey edge_key(int assignment1, int assignment2) {
+            return std::minmax(assignment1, assignment2);
+        }
+
+        int no_assignments() const { return static_cast<int>(this->unaries.size()); }
+        int no_edges()       const { return static_cast<int>(this->frozen ? this->edges_csr.neighbours.size() : this->edges.size()); }
+
+        const std::pmr::vector<CostValue>& unary_costs() const { return unaries; }     // Indexed by assignment id
+
+        // Assignment of every id. Built from the reverse index.
+        std::vector<AssignmentIdx> assignments() const;
+
+        // Calls f(edge_key, cost) for every edge.
+        template <typename F>
+        void for_each_edge(F&& f) const;
+
+        // Node based iteration. Call f(assignment, cost) for every assignment in order of ids,
+        // and f(edge, cost) for every edge, with the assignment of smaller id first.
+        template <typename F>
+        void for_each_assignment(F&& f) const;
+        template <typename F>
+        void for_each_edge_idx(F&& f) const;
+
+        // Hash maps are used while building the model. Freezing compacts the edges into a CSR layout,
+        // with rows given by the assignment id. Edge lookups of a frozen cost map search the CSR rows.
+        // For dense graph pairs, freezing also replaces the reverse index lookup by a dense id matrix,
+        // and stores the unary costs in a matrix of the same shape, so that unary lookups are a single load.
+        // Hash maps that are replaced this way are released. Thawing rebuilds them.
+        void freeze(int no_nodes1, int no_nodes2);
+        void thaw();
+
+        // Bulk alternative to set_unary/set_pairwise and freeze. Takes over a complete frozen layout.
+        // Assignment i is assignments[i] with cost unaries[i]. The edge layout is validated, not rebuilt.
+        // No hash maps are built, except for the reverse index of graph pairs too sparse for the dense index.
+        // Throws std::invalid_argument on malformed input, including NaN unary costs.
+        void assign_frozen(const std::pmr::vector<AssignmentIdx>& assignments, std::pmr::vector<CostValue> unaries, 
+                            EdgeCSR edges, int no_nodes1, int no_nodes2);
+        bool is_frozen() const { return frozen; }
+        const EdgeCSR& frozen_edges() const { return edges_csr; }
+
+        // Symmetric variant of the frozen CSR layout. Every edge is stored in the rows of both its assignments,
+        // so that all edges incident to one assignment form a contiguous range. Needs a frozen cost map.
+        void build_incidence();
+        const EdgeCSR& incidence() const { return incidence_csr; }
+
+        bool has_dense_index() const { return !ids_dense.empty(); }
+
+        MemoryUsage memory_usage() const;
+
+        // A dense cell holds an int id and a CostValue, 12 bytes (8 with float costs). A reverse index entry
+        // holds 12 bytes plus 1.25 to 2.5 buckets of 8 bytes. Dense needs less memory from 37.5% (25%) density on.
+        static inline double dense_unary_threshold = (sizeof(int) + sizeof(CostValue)) / 32.0;
 
         // rule of five
         CostMap(const CostMap& other)             = default;
@@ -69,10 +189,64 @@ class CostMap {
         CostMap& operator=(CostMap&& other)       = default;
 
     private:
-        AssignmentContainer assignments;
+        // Set by the GmModel owning the cost map, which adds assignments through add_unary.
+        friend class GmModel;
+        bool owned_by_model = false;
+        void add_unary(int node1, int node2, double cost);
+
+        // Cost of the edge, or nullptr if it does not exist.
+        const CostValue* find_edge(int assignment1, int assignment2) const;
+        template <typename CSR>
+        static auto find_in_row(CSR& csr, int row, int neighbour) -> decltype(&csr.costs[0]);
+
+        AssignmentContainer assignment_index;
+        std::pmr::vector<CostValue> unaries;
         EdgeContainer edges;
 
-        EdgeIdx sort_edge_indices(EdgeIdx idx) const;
+        bool frozen = false;
+        EdgeCSR edges_csr;
+        EdgeCSR incidence_csr;
+
+        // Row-major [dense_rows x dense_cols] matrix of assignment ids. Missing assignments hold -1.
+        std::pmr::vector<int> ids_dense;
+        int dense_rows = 0;
+        int dense_cols = 0;
+
+        // Unary costs in the layout of ids_dense. Missing assignments hold NaN, so NaN costs are rejected on insertion.
+        std::pmr::vector<CostValue> unaries_dense;
+        void fill_dense_unaries();
 };
+
+template <typename F>
+void CostMap::for_each_edge(F&& f) const {
+    if (!this->frozen) {
+        for (const auto& [key, cost] : this->edges) {
+            f(key, cost);
+        }
+        return;
+    }
+    const auto& csr = this->edges_csr;
+    for (int a = 0; a < csr.no_rows(); a++) {
+        for (int i = csr.offsets[a]; i < csr.offsets[a+1]; i++) {
+            f(EdgeKey(a, csr.neighbours[i]), csr.costs[i]);
+        }
+    }
+}
+
+template <typename F>
+void CostMap::for_each_assignment(F&& f) const {
+    auto assignments = this->assignments();
+    for (size_t id = 0; id < assignments.size(); id++) {
+        f(assignments[id], static_cast<double>(this->unaries[id]));
+    }
+}
+
+template <typename F>
+void CostMap::for_each_edge_idx(F&& f) const {
+    auto assignments = this->assignments();
+    this->for_each_edge([&f, &assignments](EdgeKey key, CostValue cost) {
+        f(EdgeIdx(assignments[key.first], assignments[key.second]), static_cast<double>(cost));
+    });
+}
 }
 #endif
\ No newline at end of file
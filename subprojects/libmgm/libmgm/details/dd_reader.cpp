@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LIBMGM_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "dd_reader.hpp"
+
+namespace mgm::io::details {
+
+LineReader::LineReader(std::istream& stream, size_t buffer_size) 
+    : stream(&stream), buffer(buffer_size), data(buffer.data()) {}
+
+LineReader::LineReader(const char* first, const char* last) 
+    : data(first), end(last - first), eof(true) {}
+
+bool LineReader::refill() {
+    if (this->eof)
+        return false;
+
+    // Keep the unread part of the current line.
+    size_t remaining = this->end - this->pos;
+    if (this->pos > 0) {
+        std::memmove(this->buffer.data(), this->data + this->pos, remaining);
+        this->pos = 0;
+        this->end = remaining;
+    }
+    // Line longer than the buffer
+    if (this->end == this->buffer.size()) {
+        this->buffer.resize(2 * this->buffer.size());
+        this->data = this->buffer.data();
+    }
+
+    this->stream->read(this->buffer.data() + this->end, this->buffer.size() - this->end);
+    size_t read = this->stream->gcount();
+    this->end += read;
+
+    if (!*this->stream) {
+        this->eof = true;
+    }
+    return read > 0;
+}
+
+bool LineReader::next_line(std::string_view& line) {
+    size_t searched = 0; // Part of the current line without a line break
+    while (true) {
+        const char* begin   = this->data + this->pos;
+        size_t available    = this->end - this->pos;
+        const char* newline = static_cast<const char*>(std::memchr(begin + searched, '\n', available - searched));
+
+        if (newline) {
+            line = std::string_view(begin, newline - begin);
+            this->pos += line.size() + 1;
+            break;
+        }
+
+        searched = available;
+        if (!this->refill()) {
+            // Last line without line break
+            if (this->pos == this->end)
+                return false;
+            line = std::string_view(this->data + this->pos, this->end - this->pos);
+            this->pos = this->end;
+            break;
+        }
+    }
+
+    // Windows line endings
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    this->line_no++;
+    return true;
+}
+
+char LineReader::peek() {
+    if (this->pos == this->end && !this->refill())
+        return '\0';
+    return this->data[this->pos];
+}
+
+DdFile::DdFile(const std::filesystem::path& path, Access access) {
+    auto compression = compression_of(path);
+    if (compression != Compression::none) {
+        this->decompressor = std::make_unique<DecompressingBuffer>(path, compression);
+        this->decompressed = std::make_unique<std::istream>(this->decompressor.get());
+        // Rethrows decompression errors instead of ending the input early.
+        this->decompressed->exceptions(std::ios::badbit);
+        this->line_reader = std::make_unique<LineReader>(*this->decompressed);
+        return;
+    }
+
+    if (this->map(path, access)) {
+        this->line_reader = std::make_unique<LineReader>(this->mapping, this->mapping + this->mapping_size);
+        return;
+    }
+
+    this->stream.open(path, std::ios::binary);
+    if (!this->stream) {
+        spdlog::error("Could not open file: {}", path.string());
+        throw std::invalid_argument("Could not open file: " + path.string());
+    }
+    this->line_reader = std::make_unique<LineReader>(this->stream);
+}
+
+DdFile::~DdFile() {
+#ifdef LIBMGM_HAS_MMAP
+    if (this->mapping) {
+        munmap(const_cast<char*>(this->mapping), this->mapping_size);
+    }
+#endif
+}
+
+void DdFile::will_need(const char* first, const char* last) const {
+#ifdef LIBMGM_HAS_MMAP
+    if (!this->mapping || first >= last)
+        return;
+
+    // madvise takes page aligned addresses. The mapping itself starts at a page boundary.
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t begin = (size_t) (first - this->mapping) / page_size * page_size;
+    size_t end = std::min((size_t) (last - this->mapping), this->mapping_size);
+    madvise(const_cast<char*>(this->mapping) + begin, end - begin, MADV_WILLNEED);
+#else
+    (void) first;
+    (void) last;
+#endif
+}
+
+bool DdFile::map(const std::filesystem::path& path, Access access) {
+#ifdef LIBMGM_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    // Pipes and other special files can't be mapped. Empty files can't be mapped either.
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping stays valid.
+    if (p == MAP_FAILED) {
+        spdlog::debug("Failed to map {}. Falling back to buffered reading.", path.string());
+        return false;
+    }
+    // Sequential read ahead would fetch pages far from where parallel tasks or lazy loads read.
+    // Parallel reads advise each block as it is parsed instead (see will_need),
+    // as paging in all of a large file at once could evict the blocks parsed first.
+    if (access == Access::sequential) {
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+    }
+
+    this->mapping = static_cast<const char*>(p);
+    this->mapping_size = st.st_size;
+    return true;
+#else
+    (void) path;
+    (void) access;
+    return false;
+#endif
+}
+
+void LineTokenizer::skip_whitespace() {
+    while (this->first != this->last && (*this->first == ' ' || *this->first == '\t')) {
+        this->first++;
+    }
+}
+
+void LineTokenizer::skip_token() {
+    this->skip_whitespace();
+    while (this->first != this->last && *this->first != ' ' && *this->first != '\t') {
+        this->first++;
+    }
+}
+
+bool LineTokenizer::at_end() {
+    this->skip_whitespace();
+    return this->first == this->last;
+}
+
+int LineTokenizer::next_int() {
+    this->skip_whitespace();
+    int value = 0;
+    auto [ptr, ec] = std::from_chars(this->first, this->last, value);
+    if (ec != std::errc()) {
+        throw std::invalid_argument("Expected integer, got '" + std::string(this->first, this->last) + "'");
+    }
+    this->first = ptr;
+    return value;
+}
+
+double LineTokenizer::strtod_token() {
+    // strtod needs a terminated string, so the token is copied.
+    const char* token_end = std::find_if(this->first, this->last, [](char c) { return c == ' ' || c == '\t'; });
+    std::string token(this->first, token_end);
+    char* ptr = nullptr;
+    double value = std::strtod(token.c_str(), &ptr);
+    if (ptr == token.c_str()) {
+        throw std::invalid_argument("Expected number, got '" + std::string(this->first, this->last) + "'");
+    }
+    this->first += ptr - token.c_str();
+    return value;
+}
+
+double LineTokenizer::next_double() {
+    this->skip_whitespace();
+    if (this->first != this->last && *this->first == '+') {
+        this->first++;
+    }
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    double value = 0.0;
+    auto [ptr, ec] = std::from_chars(this->first, this->last, value);
+    if (ec == std::errc::invalid_argument) {
+        throw std::invalid_argument("Expected number, got '" + std::string(this->first, this->last) + "'");
+    }
+    if (ec == std::errc::result_out_of_range) {
+        // from_chars leaves the value untouched. strtod rounds to zero or infinity.
+        return this->strtod_token();
+    }
+    this->first = ptr;
+    return value;
+#else
+    // Standard libraries without floating point from_chars (e.g. libc++ on macOS).
+    return this->strtod_token();
+#endif
+}
+
+}
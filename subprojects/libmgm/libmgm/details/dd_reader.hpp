@@ -0,0 +1,113 @@
+#ifndef LIBMGM_DD_READER_HPP
+#define LIBMGM_DD_READER_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "decompression.hpp"
+
+namespace mgm::io::details {
+
+// Reads a .dd file line by line, either out of a large buffer or directly out of memory.
+// Returned lines are views without the line break. For streams, they stay valid until the next call.
+class LineReader {
+    public:
+        explicit LineReader(std::istream& stream, size_t buffer_size = 1 << 22);
+
+        // Reads from memory, e.g. a mapped file. Lines stay valid as long as the memory.
+        LineReader(const char* first, const char* last);
+
+        // False at the end of the input.
+        bool next_line(std::string_view& line);
+
+        // First character of the next line. '\0' at the end of the input.
+        char peek();
+
+        // Number of the line returned last, starting at 1.
+        size_t line_number() const { return this->line_no; }
+
+    private:
+        std::istream* stream = nullptr; // Empty, if reading from memory
+        std::vector<char> buffer;
+        const char* data = nullptr; // Either buffer or the memory to read from
+        size_t pos = 0; // Begin of unread data
+        size_t end = 0; // End of valid data
+        bool eof = false;
+        size_t line_no = 0;
+
+        // Moves unread data to the front of the buffer and reads more. False, if nothing could be read.
+        bool refill();
+};
+
+// Input file of the parser.
+// Regular files are memory mapped and read without copying them into a buffer.
+// Files that can't be mapped (pipes, or on platforms without mmap) are read through a buffered stream.
+// Compressed files (.gz, .zst) are decompressed on a background thread while they are read.
+class DdFile {
+    public:
+        // How a mapped file is going to be read. Only used as a paging hint for the kernel.
+        enum class Access { 
+            sequential, // Front to back by the line reader
+            parallel,   // Entirely, but by several threads at different offsets (see parse_blocks)
+            random      // Partially, on demand (see open_lazy)
+        };
+
+        // Throws std::invalid_argument, if the file can't be opened.
+        explicit DdFile(const std::filesystem::path& path, Access access = Access::sequential);
+        ~DdFile();
+
+        DdFile(const DdFile&) = delete;
+        DdFile& operator=(const DdFile&) = delete;
+
+        LineReader& reader() { return *this->line_reader; }
+        bool is_mapped() const { return this->mapping != nullptr; }
+
+        // Entire file. Empty, if the file is not mapped.
+        std::string_view contents() const { return std::string_view(this->mapping, this->mapping_size); }
+
+        // Asks the kernel to page in [first, last) of the mapping, e.g. right before a task parses it.
+        // No-op, if the file is not mapped.
+        void will_need(const char* first, const char* last) const;
+
+    private:
+        const char* mapping = nullptr;
+        size_t mapping_size = 0;
+
+        std::ifstream stream;
+        std::unique_ptr<DecompressingBuffer> decompressor;
+        std::unique_ptr<std::istream> decompressed;
+        std::unique_ptr<LineReader> line_reader;
+
+        bool map(const std::filesystem::path& path, Access access);
+};
+
+// Parses whitespace separated numbers from a single line.
+// Throws std::invalid_argument on malformed or missing numbers.
+class LineTokenizer {
+    public:
+        explicit LineTokenizer(std::string_view line) : first(line.data()), last(line.data() + line.size()) {};
+
+        int     next_int();
+        double  next_double();
+
+        // Skips the leading record type, e.g. "a" or "e".
+        void skip_token();
+
+        // True, if only whitespace is left.
+        bool at_end();
+
+    private:
+        const char* first;
+        const char* last;
+
+        void skip_whitespace();
+        double strtod_token();
+};
+
+}
+#endif
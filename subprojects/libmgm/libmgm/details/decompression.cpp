@@ -0,0 +1,250 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef LIBMGM_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef LIBMGM_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "decompression.hpp"
+
+namespace mgm::io::details {
+
+Compression compression_of(const std::filesystem::path& path) {
+    auto extension = path.extension();
+    if (extension == ".gz")
+        return Compression::gzip;
+    if (extension == ".zst")
+        return Compression::zstd;
+    return Compression::none;
+}
+
+DecompressingBuffer::DecompressingBuffer(const std::filesystem::path& path, Compression compression)
+    : compression(compression) {
+#ifndef LIBMGM_HAS_ZLIB
+    if (compression == Compression::gzip) {
+        spdlog::error("Can't read {}. libmgm was built without zlib.", path.string());
+        throw std::invalid_argument("Can't read " + path.string() + ". libmgm was built without zlib.");
+    }
+#endif
+#ifndef LIBMGM_HAS_ZSTD
+    if (compression == Compression::zstd) {
+        spdlog::error("Can't read {}. libmgm was built without zstd.", path.string());
+        throw std::invalid_argument("Can't read " + path.string() + ". libmgm was built without zstd.");
+    }
+#endif
+    if (compression == Compression::none) {
+        throw std::invalid_argument("File is not compressed: " + path.string());
+    }
+
+    this->file.open(path, std::ios::binary);
+    if (!this->file) {
+        spdlog::error("Could not open file: {}", path.string());
+        throw std::invalid_argument("Could not open file: " + path.string());
+    }
+
+    this->worker = std::thread(&DecompressingBuffer::run, this);
+}
+
+DecompressingBuffer::~DecompressingBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopped = true;
+    }
+    this->chunk_consumed.notify_all();
+    this->worker.join();
+}
+
+DecompressingBuffer::int_type DecompressingBuffer::underflow() {
+    if (this->gptr() < this->egptr())
+        return traits_type::to_int_type(*this->gptr());
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (!this->current.empty()) {
+        this->current.clear();
+        this->free_chunks.push_back(std::move(this->current));
+        this->chunk_consumed.notify_one();
+    }
+
+    this->chunk_ready.wait(lock, [this]() { return !this->chunks.empty() || this->finished; });
+    if (this->chunks.empty()) {
+        if (this->error)
+            std::rethrow_exception(this->error);
+        return traits_type::eof();
+    }
+
+    this->current = std::move(this->chunks.front());
+    this->chunks.pop_front();
+    this->chunk_consumed.notify_one();
+    lock.unlock();
+
+    this->setg(this->current.data(), this->current.data(), this->current.data() + this->current.size());
+    return traits_type::to_int_type(*this->gptr());
+}
+
+void DecompressingBuffer::run() {
+    try {
+        if (this->compression == Compression::gzip) {
+            this->inflate_gzip();
+        }
+        else {
+            this->decompress_zstd();
+        }
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->finished = true;
+    }
+    this->chunk_ready.notify_one();
+}
+
+std::vector<char> DecompressingBuffer::take_free_chunk() {
+    std::vector<char> chunk;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->free_chunks.empty()) {
+            chunk = std::move(this->free_chunks.back());
+            this->free_chunks.pop_back();
+        }
+    }
+    chunk.resize(CHUNK_SIZE);
+    return chunk;
+}
+
+bool DecompressingBuffer::push(std::vector<char>&& chunk) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->chunk_consumed.wait(lock, [this]() { return this->chunks.size() < MAX_CHUNKS || this->stopped; });
+    if (this->stopped)
+        return false;
+
+    this->chunks.push_back(std::move(chunk));
+    lock.unlock();
+    this->chunk_ready.notify_one();
+    return true;
+}
+
+size_t DecompressingBuffer::read_input(std::vector<char>& buffer) {
+    this->file.read(buffer.data(), buffer.size());
+    if (this->file.bad()) {
+        throw std::runtime_error("Failed to read compressed file.");
+    }
+    return this->file.gcount();
+}
+
+void DecompressingBuffer::inflate_gzip() {
+#ifdef LIBMGM_HAS_ZLIB
+    z_stream stream{};
+    // 15 + 32: Maximum window size, detect gzip or zlib header.
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        throw std::runtime_error("Failed to initialize zlib.");
+    }
+    // inflateEnd must be called on every exit.
+    std::unique_ptr<z_stream, int(*)(z_stream*)> guard(&stream, inflateEnd);
+
+    std::vector<char> input(CHUNK_SIZE);
+    auto output = this->take_free_chunk();
+    stream.next_out  = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = output.size();
+
+    bool eof        = false;
+    bool stream_end = false;
+    while (true) {
+        if (stream.avail_in == 0 && !eof) {
+            size_t read = this->read_input(input);
+            eof = (read == 0);
+            stream.next_in  = reinterpret_cast<Bytef*>(input.data());
+            stream.avail_in = read;
+        }
+        if (stream.avail_in == 0 && eof && stream_end)
+            break;
+
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            // Concatenated gzip files (e.g. from pigz) consist of multiple members.
+            stream_end = true;
+            inflateReset(&stream);
+        }
+        else if (ret == Z_OK) {
+            stream_end = false;
+        }
+        else if (ret == Z_BUF_ERROR) {
+            // No progress possible. Output space is always available, so the input ended.
+            throw std::invalid_argument("Unexpected end of gzip file.");
+        }
+        else {
+            throw std::invalid_argument(std::string("Corrupt gzip file: ") + (stream.msg ? stream.msg : "inflate failed"));
+        }
+
+        if (stream.avail_out == 0) {
+            if (!this->push(std::move(output)))
+                return;
+            output = this->take_free_chunk();
+            stream.next_out  = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = output.size();
+        }
+    }
+
+    output.resize(output.size() - stream.avail_out);
+    if (!output.empty()) {
+        this->push(std::move(output));
+    }
+#endif
+}
+
+void DecompressingBuffer::decompress_zstd() {
+#ifdef LIBMGM_HAS_ZSTD
+    std::unique_ptr<ZSTD_DCtx, size_t(*)(ZSTD_DCtx*)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    if (!context) {
+        throw std::runtime_error("Failed to initialize zstd.");
+    }
+
+    std::vector<char> input(ZSTD_DStreamInSize());
+    auto output = this->take_free_chunk();
+    ZSTD_outBuffer out{output.data(), output.size(), 0};
+
+    size_t remaining_hint = 0; // 0 at the end of a frame
+    size_t read = 0;
+    while ((read = this->read_input(input)) > 0) {
+        ZSTD_inBuffer in{input.data(), read, 0};
+        while (true) {
+            remaining_hint = ZSTD_decompressStream(context.get(), &out, &in);
+            if (ZSTD_isError(remaining_hint)) {
+                throw std::invalid_argument(std::string("Corrupt zstd file: ") + ZSTD_getErrorName(remaining_hint));
+            }
+
+            // A full output buffer may leave data in the decoder, which is flushed by the next call.
+            bool full = (out.pos == out.size);
+            if (full) {
+                if (!this->push(std::move(output)))
+                    return;
+                output = this->take_free_chunk();
+                out = ZSTD_outBuffer{output.data(), output.size(), 0};
+            }
+            if (in.pos == in.size && !full)
+                break;
+        }
+    }
+    if (remaining_hint != 0) {
+        throw std::invalid_argument("Unexpected end of zstd file.");
+    }
+
+    output.resize(out.pos);
+    if (!output.empty()) {
+        this->push(std::move(output));
+    }
+#endif
+}
+
+}
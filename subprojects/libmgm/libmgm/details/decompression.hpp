@@ -0,0 +1,76 @@
+#ifndef LIBMGM_DECOMPRESSION_HPP
+#define LIBMGM_DECOMPRESSION_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace mgm::io::details {
+
+enum class Compression {
+    none,
+    gzip,   // .gz, needs zlib
+    zstd    // .zst, needs libzstd
+};
+
+// By file extension.
+Compression compression_of(const std::filesystem::path& path);
+
+// Stream buffer over a compressed file. The file is decompressed chunk by chunk on a background thread,
+// so decompression overlaps with reading. At most a few chunks are buffered ahead of the reader.
+// Decompression errors are rethrown by the reading thread. Wrap in an std::istream with
+// exceptions(std::ios::badbit) to receive them.
+class DecompressingBuffer : public std::streambuf {
+    public:
+        // Throws std::invalid_argument, if the file can't be opened or the format is not supported by this build.
+        DecompressingBuffer(const std::filesystem::path& path, Compression compression);
+        ~DecompressingBuffer() override;
+
+        DecompressingBuffer(const DecompressingBuffer&) = delete;
+        DecompressingBuffer& operator=(const DecompressingBuffer&) = delete;
+
+        static constexpr size_t CHUNK_SIZE  = 1 << 20;
+        static constexpr size_t MAX_CHUNKS  = 4;
+
+    protected:
+        int_type underflow() override;
+
+    private:
+        std::ifstream file;
+        Compression compression;
+
+        std::mutex mutex;
+        std::condition_variable chunk_ready;
+        std::condition_variable chunk_consumed;
+        std::deque<std::vector<char>> chunks;       // Decompressed, not yet read
+        std::vector<std::vector<char>> free_chunks; // Read, ready to be reused
+        bool finished   = false; // Set by the worker
+        bool stopped    = false; // Set by the reader
+        std::exception_ptr error;
+
+        std::vector<char> current; // Chunk the get area points into
+
+        std::thread worker;
+
+        void run();
+        void inflate_gzip();
+        void decompress_zstd();
+
+        // Empty chunk with CHUNK_SIZE capacity.
+        std::vector<char> take_free_chunk();
+
+        // Blocks while MAX_CHUNKS are waiting. False, if the reader stopped.
+        bool push(std::vector<char>&& chunk);
+
+        // Reads compressed input. 0 at the end of the file.
+        size_t read_input(std::vector<char>& buffer);
+};
+
+}
+#endif
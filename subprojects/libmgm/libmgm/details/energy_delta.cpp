@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "energy_delta.hpp"
+#include "solution.hpp"
+
+constexpr double INFINITY_COST = 1e99;
+
+namespace mgm {
+
+namespace {
+inline int node_or_none(const CliqueTable::Clique& c, int graph_id) {
+    auto it = c.find(graph_id);
+    return (it != c.end()) ? it->second : -1;
+}
+
+inline double unary_or_infinity(int assignment_id, const CostMap& costs) {
+    return (assignment_id >= 0) ? costs.unary_costs()[assignment_id] : INFINITY_COST;
+}
+}
+
+EnergyDelta::EnergyDelta(std::shared_ptr<MgmModel> model, const CliqueTable& table)
+    : model(model), table(table) {
+    this->rebuild();
+}
+
+void EnergyDelta::rebuild() {
+    this->clique_ids.resize(this->model->no_graphs);
+    for (int g = 0; g < this->model->no_graphs; g++) {
+        this->clique_ids[g].assign(this->model->graphs[g].no_nodes, -1);
+    }
+
+    int clique_id = 0;
+    for (const auto& c : this->table) {
+        for (const auto& [g, n] : c) {
+            this->clique_ids[g][n] = clique_id;
+        }
+        clique_id++;
+    }
+}
+
+void EnergyDelta::apply_swap(const CliqueTable::Clique& A, const CliqueTable::Clique& B, const std::vector<int>& graph_ids, 
+                             int clique_A, int clique_B) {
+    for (int g : graph_ids) {
+        int alpha = node_or_none(A, g);
+        int beta  = node_or_none(B, g);
+        assert(alpha < 0 || this->clique_ids[g][alpha] == clique_A);
+        assert(beta  < 0 || this->clique_ids[g][beta]  == clique_B);
+
+        if (alpha >= 0)
+            this->clique_ids[g][alpha] = clique_B;
+        if (beta >= 0)
+            this->clique_ids[g][beta] = clique_A;
+    }
+}
+
+double EnergyDelta::swap(const CliqueTable::Clique& A, const CliqueTable::Clique& B, const std::vector<int>& graph_ids) {
+    std::vector<bool> swapped(this->model->no_graphs, false);
+    for (int g : graph_ids) {
+        swapped[g] = true;
+    }
+
+    // Pairs with both or none of the graphs swapped keep their assignments.
+    std::vector<int> others;
+    for (const auto& [g, n] : A) {
+        if (!swapped[g])
+            others.push_back(g);
+    }
+    for (const auto& [g, n] : B) {
+        if (!swapped[g] && A.find(g) == A.end())
+            others.push_back(g);
+    }
+
+    double delta = 0.0;
+    for (int g1 : graph_ids) {
+        int alpha1 = node_or_none(A, g1);
+        int beta1  = node_or_none(B, g1);
+        for (int g2 : others) {
+            delta += this->pair(g1, g2, alpha1, node_or_none(A, g2), beta1, node_or_none(B, g2));
+        }
+    }
+    return delta;
+}
+
+double EnergyDelta::swap(int clique_A, int clique_B, const std::vector<int>& graph_ids) {
+    return this->swap(this->table[clique_A], this->table[clique_B], graph_ids);
+}
+
+double EnergyDelta::move(int graph_id, const CliqueTable::Clique& A, const CliqueTable::Clique& B) {
+    return this->swap(A, B, {graph_id});
+}
+
+double EnergyDelta::move(int graph_id, int clique_A, int clique_B) {
+    return this->swap(this->table[clique_A], this->table[clique_B], {graph_id});
+}
+
+double EnergyDelta::pair(int g1, int g2, int alpha1, int alpha2, int beta1, int beta2) const {
+    if (g1 > g2) {
+        return this->pair(g2, g1, alpha2, alpha1, beta2, beta1);
+    }
+    const auto m = this->model->gm_model(g1, g2);
+    if (!m) {
+        return 0.0; // No costs between the graphs
+    }
+    double cost = 0.0;
+
+    auto old_assignment_1 = AssignmentIdx(alpha1, alpha2);
+    auto old_assignment_2 = AssignmentIdx(beta1, beta2);
+
+    auto new_assignment_1 = AssignmentIdx(alpha1, beta2);
+    auto new_assignment_2 = AssignmentIdx(beta1, alpha2);
+
+    // Resolve assignment ids once. Edges are looked up by id below.
+    const auto& costs = *m->costs;
+    int old_id_1 = costs.assignment_id(old_assignment_1);
+    int old_id_2 = costs.assignment_id(old_assignment_2);
+    int new_id_1 = costs.assignment_id(new_assignment_1);
+    int new_id_2 = costs.assignment_id(new_assignment_2);
+
+    if (alpha1 != -1) {
+        if(alpha2 != -1) 
+            cost -= unary_or_infinity(old_id_1, costs);
+        if(beta2 != -1)
+            cost += unary_or_infinity(new_id_1, costs);
+    }
+    if(beta1 != -1) {
+        if(beta2 != -1)
+            cost -= unary_or_infinity(old_id_2, costs);
+        if(alpha2 != -1)
+            cost += unary_or_infinity(new_id_2, costs);
+    }
+    
+    // pairwise
+    // An assignment is active, if both of its nodes are in the same clique. The old assignments are excluded.
+    const auto& cliques1    = this->clique_ids[g1];
+    const auto& cliques2    = this->clique_ids[g2];
+    const auto& assignments = m->assignment_list;
+    auto is_active = [&](int assignment_id) {
+        if (assignment_id == old_id_1 || assignment_id == old_id_2)
+            return false;
+        const auto& [node1, node2] = assignments[assignment_id];
+        return cliques1[node1] >= 0 && cliques1[node1] == cliques2[node2];
+    };
+
+    // Only visit edges incident to the flipped assignments.
+    const auto& incidence = m->incidence();
+    auto incident_cost = [&](int assignment_id) {
+        double sum = 0.0;
+        if (assignment_id < 0)
+            return sum;
+
+        for (int i = incidence.offsets[assignment_id]; i < incidence.offsets[assignment_id + 1]; i++) {
+            if (is_active(incidence.neighbours[i]))
+                sum += incidence.costs[i];
+        }
+        return sum;
+    };
+    cost -= incident_cost(old_id_1);
+    cost -= incident_cost(old_id_2);
+    cost += incident_cost(new_id_1);
+    cost += incident_cost(new_id_2);
+
+    // account for edge between old and new assignments.
+    cost -= costs.pairwise_or(old_id_1, old_id_2, 0.0);
+    cost += costs.pairwise_or(new_id_1, new_id_2, 0.0);
+
+    return cost;
+}
+
+double EnergyDelta::graph_energy(const MgmModel& model, const CliqueTable& table, int graph_id) {
+    // Labelings of the models with graph_id, read off the cliques that contain a node of graph_id.
+    // Indexed by the other graph.
+    std::vector<std::vector<int>> labelings(model.no_graphs);
+    for (int g = 0; g < model.no_graphs; g++) {
+        if (g == graph_id)
+            continue;
+        int labeling_size = model.graphs[std::min(g, graph_id)].no_nodes;
+        labelings[g].assign(labeling_size, -1);
+    }
+
+    for (const auto& c : table) {
+        auto it = c.find(graph_id);
+        if (it == c.end())
+            continue;
+
+        int node = it->second;
+        for (const auto& [g, n] : c) {
+            if (g < graph_id) {
+                labelings[g][n] = node;
+            }
+            else if (g > graph_id) {
+                labelings[g][node] = n;
+            }
+        }
+    }
+
+    double result = 0.0;
+    for (const auto& idx : model.model_keys()) {
+        if (idx.first == graph_id || idx.second == graph_id) {
+            int other = (idx.first == graph_id) ? idx.second : idx.first;
+            result += GmSolution::evaluate(*model.gm_model(idx.first, idx.second), labelings[other]);
+        }
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,57 @@
+#ifndef LIBMGM_ENERGY_DELTA_HPP
+#define LIBMGM_ENERGY_DELTA_HPP
+
+#include <memory>
+#include <vector>
+
+#include "cliques.hpp"
+#include "multigraph.hpp"
+
+namespace mgm {
+
+// Exact energy change of clique moves, evaluated on a clique table without building the new state.
+// Only the pairs of graphs, whose assignments change, are visited. Within a pair, only edges incident to the changed assignments.
+// Holds a reference to the table and an index of the clique of every node. Deltas refer to the state of the index.
+// Changes of the table have to be passed on by apply_swap() or rebuild().
+class EnergyDelta {
+    public:
+        EnergyDelta(std::shared_ptr<MgmModel> model, const CliqueTable& table);
+
+        // Exchanges the nodes of `graph_ids` between cliques A and B.
+        // A node, whose graph is contained in only one of the cliques, moves to the other one.
+        // A and B may be cliques outside the table, e.g. an empty clique to split off nodes.
+        double swap(const CliqueTable::Clique& A, const CliqueTable::Clique& B, const std::vector<int>& graph_ids);
+        double swap(int clique_A, int clique_B, const std::vector<int>& graph_ids);
+
+        // Moves the node of graph `graph_id` from clique A to clique B.
+        // If B contains a node of that graph, it moves to A.
+        double move(int graph_id, const CliqueTable::Clique& A, const CliqueTable::Clique& B);
+        double move(int graph_id, int clique_A, int clique_B);
+
+        // Change within the model of (g1, g2), if only one of the graphs swaps its nodes between two cliques.
+        // alpha: nodes in the first clique, beta: nodes in the second clique, -1 if not contained.
+        // Zero, if there is no model for the pair.
+        double pair(int g1, int g2, int alpha1, int alpha2, int beta1, int beta2) const;
+
+        // Energy of all models containing graph `graph_id` under `table`. Equals MgmSolution::evaluate(graph_id).
+        // A full evaluation of the graph, for states that differ in more than a move. Needs no index.
+        static double graph_energy(const MgmModel& model, const CliqueTable& table, int graph_id);
+
+        // Updates the index before the nodes of `graph_ids` are exchanged between A and B (see swap), e.g. by details::flip.
+        // clique_A and clique_B are their ids. A clique not yet added to the table needs an id unused by the table.
+        void apply_swap(const CliqueTable::Clique& A, const CliqueTable::Clique& B, const std::vector<int>& graph_ids, 
+                        int clique_A, int clique_B);
+
+        // Rebuilds the index from the table, e.g. after cliques were added or removed.
+        void rebuild();
+
+    private:
+        std::shared_ptr<MgmModel> model;
+        const CliqueTable& table;
+
+        // [graph_id][node_id] -> clique id, -1 if the node is in no clique.
+        std::vector<std::vector<int>> clique_ids;
+};
+
+}
+#endif
@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+#include "io_binary.hpp"
+#include "io_utils.hpp"
+#include "multigraph.hpp"
+
+namespace fs = std::filesystem;
+
+namespace mgm::io {
+
+namespace details {
+
+namespace {
+bool is_little_endian() {
+    const std::uint16_t x = 1;
+    return *reinterpret_cast<const unsigned char*>(&x) == 1;
+}
+
+template <typename T>
+void swap_bytes(T* data, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        auto* bytes = reinterpret_cast<unsigned char*>(data + i);
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+}
+
+template <typename T>
+void write_le(std::ostream& out, const T* data, size_t n) {
+    if (is_little_endian()) {
+        out.write(reinterpret_cast<const char*>(data), n * sizeof(T));
+        return;
+    }
+    std::vector<T> swapped(data, data + n);
+    swap_bytes(swapped.data(), n);
+    out.write(reinterpret_cast<const char*>(swapped.data()), n * sizeof(T));
+}
+
+template <typename T>
+void write_le(std::ostream& out, const T& value) {
+    write_le(out, &value, 1);
+}
+
+template <typename T>
+void read_le(std::istream& in, T* data, size_t n) {
+    in.read(reinterpret_cast<char*>(data), n * sizeof(T));
+    if (!in) {
+        throw std::invalid_argument("Unexpected end of file.");
+    }
+    if (!is_little_endian()) {
+        swap_bytes(data, n);
+    }
+}
+
+template <typename T>
+T read_le(std::istream& in) {
+    T value;
+    read_le(in, &value, 1);
+    return value;
+}
+
+// Costs are always stored as double.
+template <typename Vector>
+void write_costs(std::ostream& out, const Vector& costs) {
+    if constexpr (std::is_same_v<typename Vector::value_type, double>) {
+        write_le(out, costs.data(), costs.size());
+    } else {
+        std::vector<double> converted(costs.begin(), costs.end());
+        write_le(out, converted.data(), converted.size());
+    }
+}
+
+// Counterpart of write_costs. `offset` is added to every cost before it is converted to CostValue.
+void read_costs(std::istream& in, std::pmr::vector<CostValue>& costs, size_t n, double offset = 0.0) {
+    if constexpr (std::is_same_v<CostValue, double>) {
+        costs.resize(n);
+        read_le(in, costs.data(), n);
+        if (offset != 0.0) {
+            for (auto& c : costs) 
+                c += offset;
+        }
+    } else {
+        std::vector<double> stored(n);
+        read_le(in, stored.data(), n);
+        costs.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            costs[i] = static_cast<CostValue>(stored[i] + offset);
+        }
+    }
+}
+
+void write_pair(std::ostream& out, const GmModel& model) {
+    const auto& csr = model.edges();
+
+    std::vector<std::int32_t> assignments;
+    assignments.reserve(2 * model.assignment_list.size());
+    for (const auto& [node1, node2] : model.assignment_list) {
+        assignments.push_back(node1);
+        assignments.push_back(node2);
+    }
+
+    write_le(out, assignments.data(), assignments.size());
+    write_costs(out, model.costs->unary_costs());
+    write_costs(out, csr.costs);
+    write_le(out, csr.offsets.data(), csr.offsets.size());
+    write_le(out, csr.neighbours.data(), csr.neighbours.size());
+}
+
+[[noreturn]] void invalid_file(const std::string& message) {
+    spdlog::error("Invalid .mgmb file: {}", message);
+    throw std::invalid_argument("Invalid .mgmb file: " + message);
+}
+
+[[noreturn]] void invalid_solution_file(const std::string& message) {
+    spdlog::error("Invalid .mgms file: {}", message);
+    throw std::invalid_argument("Invalid .mgms file: " + message);
+}
+}
+
+std::uint64_t binary_block_size(std::int64_t no_assignments, std::int64_t no_edges) {
+    std::uint64_t size = 2 * sizeof(std::int32_t) * no_assignments     // assignments
+                       + sizeof(double) * (no_assignments + no_edges)   // unaries, costs
+                       + sizeof(std::int32_t) * (no_assignments + 1)    // offsets
+                       + sizeof(std::int32_t) * no_edges;               // neighbours
+    return (size + 7) / 8 * 8;
+}
+
+BinaryIndex read_binary_index(std::istream& in, std::uint64_t file_size) {
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0) {
+        invalid_file("Missing 'MGMB' file signature.");
+    }
+
+    auto version = read_le<std::uint32_t>(in);
+    if (version != BINARY_VERSION) {
+        invalid_file("Unsupported version " + std::to_string(version) + ". Expected " + std::to_string(BINARY_VERSION) + ".");
+    }
+    auto no_graphs = read_le<std::uint32_t>(in);
+    auto no_models = read_le<std::uint32_t>(in);
+
+    std::uint64_t table_end = 16 + 4 * (std::uint64_t) no_graphs + sizeof(BinaryPairEntry) * (std::uint64_t) no_models;
+    if (table_end > file_size) {
+        invalid_file("Truncated header.");
+    }
+
+    BinaryIndex index;
+    std::vector<std::int32_t> no_nodes(no_graphs);
+    read_le(in, no_nodes.data(), no_nodes.size());
+    for (std::uint32_t g = 0; g < no_graphs; g++) {
+        index.graphs.emplace_back(g, no_nodes[g]);
+    }
+
+    index.pairs.resize(no_models);
+    for (auto& entry : index.pairs) {
+        entry.g1             = read_le<std::int32_t>(in);
+        entry.g2             = read_le<std::int32_t>(in);
+        entry.no_assignments = read_le<std::int32_t>(in);
+        entry.no_edges       = read_le<std::int32_t>(in);
+        entry.offset         = read_le<std::uint64_t>(in);
+        entry.size           = read_le<std::uint64_t>(in);
+
+        if (entry.g1 < 0 || entry.g1 >= entry.g2 || entry.g2 >= (std::int32_t) no_graphs) {
+            invalid_file(fmt::format("Invalid graph pair ({} {}).", entry.g1, entry.g2));
+        }
+        if (entry.no_assignments < 0 || entry.no_edges < 0
+            || entry.size != binary_block_size(entry.no_assignments, entry.no_edges)
+            || entry.offset < table_end || entry.offset > file_size || entry.size > file_size - entry.offset) {
+            invalid_file(fmt::format("Invalid block of graph pair ({} {}).", entry.g1, entry.g2));
+        }
+    }
+    return index;
+}
+
+std::shared_ptr<GmModel> read_binary_pair(std::istream& in, const BinaryIndex& index, const BinaryPairEntry& entry,
+                                          double unary_constant, std::shared_ptr<ModelArena> arena) {
+    const int no_a = entry.no_assignments;
+    const int no_e = entry.no_edges;
+
+    in.seekg(entry.offset);
+
+    // Buffers are read in place and handed to the model, which validates them instead of rebuilding them.
+    auto model = std::make_shared<GmModel>(index.graphs[entry.g1], index.graphs[entry.g2], 0, 0, arena);
+    auto* resource = model->assignment_list.get_allocator().resource();
+
+    std::vector<std::int32_t> nodes(2 * (size_t) no_a);
+    read_le(in, nodes.data(), nodes.size());
+    std::pmr::vector<AssignmentIdx> assignments(resource);
+    assignments.reserve(no_a);
+    for (int a = 0; a < no_a; a++) {
+        assignments.emplace_back(nodes[2*a], nodes[2*a + 1]);
+    }
+
+    std::pmr::vector<CostValue> unaries(resource);
+    EdgeCSR csr(resource);
+    read_costs(in, unaries, no_a, unary_constant);
+    read_costs(in, csr.costs, no_e);
+
+    static_assert(sizeof(int) == sizeof(std::int32_t), "Edge offsets and neighbours are read in place.");
+    csr.offsets.resize(no_a + 1);
+    csr.neighbours.resize(no_e);
+    read_le(in, csr.offsets.data(), csr.offsets.size());
+    read_le(in, csr.neighbours.data(), csr.neighbours.size());
+
+    if (csr.offsets.front() != 0 || csr.offsets.back() != no_e || !std::is_sorted(csr.offsets.begin(), csr.offsets.end())) {
+        invalid_file(fmt::format("Corrupt edge offsets of graph pair ({} {}).", entry.g1, entry.g2));
+    }
+
+    try {
+        model->assign_frozen(std::move(assignments), std::move(unaries), std::move(csr));
+    } catch (const std::logic_error& e) {
+        invalid_file(fmt::format("Graph pair ({} {}): {}", entry.g1, entry.g2, e.what()));
+    }
+
+    return model;
+}
+
+namespace {
+// Reads pair blocks out of a .mgmb file on access.
+// Every load opens its own stream, so that pairs can be loaded concurrently.
+class BinaryModelLoader : public ModelLoader {
+    public:
+        BinaryModelLoader(const fs::path& mgmb_file, double unary_constant) 
+            : mgmb_file(mgmb_file), unary_constant(unary_constant) {
+            auto in = this->open();
+            this->index = read_binary_index(in, fs::file_size(mgmb_file));
+            for (size_t i = 0; i < this->index.pairs.size(); i++) {
+                const auto& entry = this->index.pairs[i];
+                this->entries[GmModelIdx(entry.g1, entry.g2)] = i;
+            }
+        }
+
+        std::shared_ptr<GmModel> load(int g1, int g2) override {
+            const auto& entry = this->index.pairs[this->entries.at(GmModelIdx(g1, g2))];
+            auto in = this->open();
+            return read_binary_pair(in, this->index, entry, this->unary_constant);
+        }
+
+        BinaryIndex index;
+
+    private:
+        std::ifstream open() const {
+            std::ifstream in(this->mgmb_file, std::ios::binary);
+            if (!in) {
+                spdlog::error("Could not open file: {}", this->mgmb_file.string());
+                throw std::invalid_argument("Could not open file: " + this->mgmb_file.string());
+            }
+            return in;
+        }
+
+        fs::path mgmb_file;
+        double unary_constant;
+        std::unordered_map<GmModelIdx, size_t, GmModelIdxHash> entries;
+};
+}
+
+std::shared_ptr<MgmModel> open_lazy_binary(const fs::path& mgmb_file, size_t memory_budget, double unary_constant) {
+    auto loader = std::make_shared<BinaryModelLoader>(mgmb_file, unary_constant);
+
+    auto model = std::make_shared<MgmModel>();
+    model->no_graphs = loader->index.graphs.size();
+    model->graphs = loader->index.graphs;
+
+    std::vector<GmModelIdx> keys;
+    for (const auto& entry : loader->index.pairs) {
+        keys.emplace_back(entry.g1, entry.g2);
+    }
+    model->set_loader(loader, std::move(keys), memory_budget);
+
+    return model;
+}
+
+}
+
+void export_binary(fs::path mgmb_file, std::shared_ptr<MgmModel> model) {
+    spdlog::info("Exporting model as .mgmb file.");
+
+    std::vector<GmModelIdx> keys = model->model_keys();
+    std::sort(keys.begin(), keys.end());
+
+    std::ofstream out(mgmb_file, std::ios::binary);
+    if (!out) {
+        spdlog::error("Could not open file: {}", mgmb_file.string());
+        throw std::invalid_argument("Could not open file: " + mgmb_file.string());
+    }
+
+    out.write(details::BINARY_MAGIC, sizeof(details::BINARY_MAGIC));
+    details::write_le(out, details::BINARY_VERSION);
+    details::write_le(out, (std::uint32_t) model->graphs.size());
+    details::write_le(out, (std::uint32_t) keys.size());
+
+    for (const auto& g : model->graphs) {
+        details::write_le(out, (std::int32_t) g.no_nodes);
+    }
+
+    // Entries of the pair table are only known once a model is loaded. Every model is fetched once,
+    // its block written and the pair table filled in afterwards. Blocks follow the table in its order.
+    auto table_start = out.tellp();
+    std::uint64_t offset = 16 + 4 * (std::uint64_t) model->graphs.size() + sizeof(details::BinaryPairEntry) * keys.size();
+    out.seekp(offset);
+
+    const char padding[8] = {};
+    std::vector<details::BinaryPairEntry> entries;
+    for (const auto& key : keys) {
+        auto m = model->gm_model(key.first, key.second);
+        details::BinaryPairEntry e;
+        e.g1                = key.first;
+        e.g2                = key.second;
+        e.no_assignments    = m->no_assignments();
+        e.no_edges          = m->no_edges();
+        e.offset            = offset;
+        e.size              = details::binary_block_size(e.no_assignments, e.no_edges);
+        offset += e.size;
+        entries.push_back(e);
+
+        auto block_start = out.tellp();
+        details::write_pair(out, *m);
+        out.write(padding, e.size - (out.tellp() - block_start));
+    }
+
+    out.seekp(table_start);
+    for (const auto& e : entries) {
+        details::write_le(out, e.g1);
+        details::write_le(out, e.g2);
+        details::write_le(out, e.no_assignments);
+        details::write_le(out, e.no_edges);
+        details::write_le(out, e.offset);
+        details::write_le(out, e.size);
+    }
+
+    if (!out) {
+        spdlog::error("Failed to write {}", mgmb_file.string());
+        throw std::runtime_error("Failed to write " + mgmb_file.string());
+    }
+    spdlog::info("Finished exporting.");
+}
+
+std::shared_ptr<MgmModel> parse_binary(fs::path mgmb_file, double unary_constant) {
+    if (unary_constant != 0.0) {
+        spdlog::info("Loading model with custom unary constant: {}", unary_constant);
+    }
+    std::ifstream in(mgmb_file, std::ios::binary);
+    if (!in) {
+        spdlog::error("Could not open file: {}", mgmb_file.string());
+        throw std::invalid_argument("Could not open file: " + mgmb_file.string());
+    }
+
+    auto index = details::read_binary_index(in, fs::file_size(mgmb_file));
+
+    auto model = std::make_shared<MgmModel>();
+    model->no_graphs = index.graphs.size();
+    model->graphs = index.graphs;
+
+    // All models are read into one arena. It fits the stored layouts plus the adjacency and reverse index built on reading.
+    size_t arena_size = 0;
+    for (const auto& entry : index.pairs) {
+        arena_size += entry.size + entry.size / 4 + 256;
+    }
+    auto arena = std::make_shared<ModelArena>(std::max<size_t>(arena_size, 4096));
+
+    for (const auto& entry : index.pairs) {
+        spdlog::info("Graph {} and Graph {}", entry.g1, entry.g2);
+        model->add_model(details::read_binary_pair(in, index, entry, unary_constant, arena));
+    }
+    arena->seal();
+
+    spdlog::info("Finished parsing model.\n");
+    return model;
+}
+
+void save_binary_solution(fs::path outPath, const MgmSolution& solution, bool compute_energy) {
+    if (fs::is_directory(outPath)) {
+        outPath = outPath / "solution.mgms";
+    }
+    if (outPath.extension() != ".mgms") {
+        outPath.replace_extension(".mgms");
+    }
+    fs::create_directories(outPath.parent_path());
+
+    const auto& labeling = solution.dense_labeling();
+    const auto& graphs = solution.model->graphs;
+    const auto& keys = labeling.keys(); // Ordered by graph ids
+
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out) {
+        spdlog::error("Could not open file: {}", outPath.string());
+        throw std::invalid_argument("Could not open file: " + outPath.string());
+    }
+
+    double energy = compute_energy ? solution.evaluate() : std::numeric_limits<double>::quiet_NaN();
+
+    out.write(details::SOLUTION_MAGIC, sizeof(details::SOLUTION_MAGIC));
+    details::write_le(out, details::SOLUTION_VERSION);
+    details::write_le(out, (std::uint32_t) graphs.size());
+    details::write_le(out, (std::uint32_t) keys.size());
+    details::write_le(out, energy);
+    for (const auto& g : graphs) {
+        details::write_le(out, (std::int32_t) g.no_nodes);
+    }
+
+    for (const auto& key : keys) {
+        details::write_le(out, (std::int32_t) key.first);
+        details::write_le(out, (std::int32_t) key.second);
+        details::write_le(out, labeling.at(key), labeling.size(key));
+    }
+
+    out.close();
+    if (!out) {
+        spdlog::error("Failed to write {}", outPath.string());
+        throw std::runtime_error("Failed to write " + outPath.string());
+    }
+}
+
+MgmSolution import_binary_solution(fs::path solution_path, std::shared_ptr<MgmModel> model) {
+    std::ifstream in(solution_path, std::ios::binary);
+    if (!in) {
+        spdlog::error("Could not open file: {}", solution_path.string());
+        throw std::invalid_argument("Could not open file: " + solution_path.string());
+    }
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, details::SOLUTION_MAGIC, sizeof(magic)) != 0) {
+        details::invalid_solution_file("Missing 'MGMS' file signature.");
+    }
+    auto version = details::read_le<std::uint32_t>(in);
+    if (version != details::SOLUTION_VERSION) {
+        details::invalid_solution_file("Unsupported version " + std::to_string(version) + ". Expected " + std::to_string(details::SOLUTION_VERSION) + ".");
+    }
+    auto no_graphs  = details::read_le<std::uint32_t>(in);
+    auto no_pairs   = details::read_le<std::uint32_t>(in);
+    auto energy     = details::read_le<double>(in);
+
+    if (no_graphs != (std::uint32_t) model->graphs.size()) {
+        details::invalid_solution_file("Number of graphs does not match the model.");
+    }
+    std::vector<std::int32_t> no_nodes(no_graphs);
+    details::read_le(in, no_nodes.data(), no_nodes.size());
+    for (std::uint32_t g = 0; g < no_graphs; g++) {
+        if (no_nodes[g] != model->graphs[g].no_nodes) {
+            details::invalid_solution_file(fmt::format("Order of graph {} does not match the model.", g));
+        }
+    }
+
+    MgmSolution s(model);
+    DenseLabeling l = s.create_empty_dense_labeling();
+
+    for (std::uint32_t p = 0; p < no_pairs; p++) {
+        auto g1 = details::read_le<std::int32_t>(in);
+        auto g2 = details::read_le<std::int32_t>(in);
+
+        GmModelIdx idx(g1, g2);
+        if (!l.contains(idx)) 
+            throw std::invalid_argument("Provided model does not contain graph pair contained in labeling");
+
+        int* gm_labeling = l.at(idx);
+        details::read_le(in, gm_labeling, l.size(idx));
+        for (int i = 0; i < l.size(idx); i++) {
+            int label = gm_labeling[i];
+            if (label < -1 || label >= no_nodes[g2]) {
+                details::invalid_solution_file(fmt::format("Label {} out of range in graph pair ({} {}).", label, g1, g2));
+            }
+        }
+    }
+    s.set_solution(std::move(l));
+
+    spdlog::debug("Energy according to file: {}", energy);
+    return s;
+}
+
+}
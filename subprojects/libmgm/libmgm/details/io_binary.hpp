@@ -0,0 +1,67 @@
+#ifndef LIBMGM_IO_BINARY_HPP
+#define LIBMGM_IO_BINARY_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <vector>
+
+#include "multigraph.hpp"
+
+namespace mgm::io::details {
+
+// Binary model format (.mgmb). All values are little-endian.
+//
+//   Header       char magic[4] = "MGMB", uint32 version, uint32 no_graphs, uint32 no_models
+//   Graphs       int32 no_nodes[no_graphs]
+//   Pair table   BinaryPairEntry[no_models], ordered by graph ids
+//   Pair blocks  At BinaryPairEntry::offset, 8 byte aligned. Same layout as a frozen GmModel:
+//                  int32   assignments[2 * no_assignments]     (node1, node2), by assignment id
+//                  float64 unaries[no_assignments]
+//                  float64 costs[no_edges]                     CSR of GmModel::edges()
+//                  int32   offsets[no_assignments + 1]
+//                  int32   neighbours[no_edges]
+constexpr char          BINARY_MAGIC[4] = {'M', 'G', 'M', 'B'};
+constexpr std::uint32_t BINARY_VERSION  = 1;
+
+// Binary solution format (.mgms). All values are little-endian.
+//
+//   Header       char magic[4] = "MGMS", uint32 version, uint32 no_graphs, uint32 no_pairs, float64 energy (NaN, if not computed)
+//   Graphs       int32 no_nodes[no_graphs]
+//   Pairs        no_pairs times, ordered by graph ids:
+//                  int32   g1, g2
+//                  int32   labeling[no_nodes[g1]]              Node of g2 per node of g1, -1 if unassigned
+constexpr char          SOLUTION_MAGIC[4] = {'M', 'G', 'M', 'S'};
+constexpr std::uint32_t SOLUTION_VERSION  = 1;
+
+struct BinaryPairEntry {
+    std::int32_t  g1;
+    std::int32_t  g2;
+    std::int32_t  no_assignments;
+    std::int32_t  no_edges;
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+struct BinaryIndex {
+    std::vector<Graph> graphs;
+    std::vector<BinaryPairEntry> pairs;
+};
+
+// Size of a pair block in bytes, including padding.
+std::uint64_t binary_block_size(std::int64_t no_assignments, std::int64_t no_edges);
+
+// Reads header, graph and pair table. Throws std::invalid_argument, if the file is no valid .mgmb file.
+BinaryIndex read_binary_index(std::istream& in, std::uint64_t file_size);
+
+// Reads one pair block into a frozen GmModel. If `arena` is given, the model is allocated from it.
+// The arena needs to be sealed before the model is shared.
+std::shared_ptr<GmModel> read_binary_pair(std::istream& in, const BinaryIndex& index, const BinaryPairEntry& entry,
+                                          double unary_constant=0.0, std::shared_ptr<ModelArena> arena=nullptr);
+
+// Lazy model, which reads pair blocks on first access. See io::open_lazy.
+std::shared_ptr<MgmModel> open_lazy_binary(const std::filesystem::path& mgmb_file, size_t memory_budget, double unary_constant);
+
+}
+#endif
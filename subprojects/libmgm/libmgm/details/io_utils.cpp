@@ -1,14 +1,23 @@
+#include <algorithm>
+#include <charconv>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <numeric>
 #include <sstream>
-#include <regex>
 #include <memory>
+#include <string_view>
+#include <type_traits>
 #include <stdexcept>
 
 #include <cassert>
+#include <cmath>
+#include <limits>
 #include <cstdio>
+#include <exception>
+#include <omp.h>
 
 // Logging
 #include <spdlog/spdlog.h>
@@ -24,104 +33,239 @@ namespace fs = std::filesystem;
 using json = nlohmann::json;
 
 #include "io_utils.hpp"
+#include "dd_reader.hpp"
+#include "io_binary.hpp"
 #include "solution.hpp"
 #include "multigraph.hpp"
 #include "costs.hpp"
 
 namespace mgm::io {
 
-const std::regex re_gm("^gm ([0-9]+) ([0-9]+)$");
-const std::regex re_p("^p ([0-9]+) ([0-9]+) ([0-9]+) ([0-9]+)$");
-const std::regex re_a("^a ([0-9]+) ([0-9]+) ([0-9]+) (.+)$");
-const std::regex re_e("^e ([0-9]+) ([0-9]+) (.+)$");
-
 // Forward declaration
 namespace details {
-    void write_model(std::ofstream& outfile, std::shared_ptr<GmModel> model);
-    std::shared_ptr<GmModel> parse_gm(std::ifstream& dd_file, int g1_id, int g2_id, double unary_constant=0.0);
+    void write_model(fmt::memory_buffer& out, const GmModel& model);
+    bool parse_gm_header(std::string_view line, int& g1_id, int& g2_id);
+
+    // Model between two graphs. [first, last) spans its lines after the "gm" header.
+    struct DdBlock {
+        int g1_id;
+        int g2_id;
+        const char* first;
+        const char* last;
+    };
+    std::vector<DdBlock> find_blocks(std::string_view contents);
+    std::vector<std::shared_ptr<GmModel>> parse_blocks(const DdFile& file, const std::vector<DdBlock>& blocks, double unary_constant);
+
+    // If `arena` is given, the model is allocated from it. The arena needs to be sealed before the model is shared.
+    std::shared_ptr<GmModel> parse_gm(LineReader& reader, int g1_id, int g2_id, double unary_constant=0.0, 
+                                      std::shared_ptr<ModelArena> arena=nullptr);
 }
 
 std::shared_ptr<GmModel> parse_dd_file_gm(fs::path dd_file, double unary_constant) {
     if (unary_constant != 0.0) {
         spdlog::info("Loading model with custom unary constant: {}", unary_constant);
     }
-    std::ifstream infile(dd_file);
+    details::DdFile infile(dd_file);
 
-    return details::parse_gm(infile, 0, 1, unary_constant);
+    return details::parse_gm(infile.reader(), 0, 1, unary_constant);
 }
 
 std::shared_ptr<MgmModel> parse_dd_file(fs::path dd_file, double unary_constant) {
     if (unary_constant != 0.0) {
         spdlog::info("Loading model with custom unary constant: {}", unary_constant);
     }
-    std::ifstream infile(dd_file);
-    std::string line;
-    std::stringstream lineStream;
-    std::smatch re_match;
+    // Mapped files are parsed in parallel blocks (see parse_blocks).
+    details::DdFile infile(dd_file, details::DdFile::Access::parallel);
+    auto& reader = infile.reader();
 
-    if (infile.peek() == 'p') {
+    if (reader.peek() == 'p') {
         spdlog::error("Given file begins with GM model definition. Missing 'gm <graph1_id> <graph2_id>'.");
         throw std::invalid_argument("Given file begins with GM model definition. Missing 'gm <graph1_id> <graph2_id>'.");
     }
 
     auto model = std::make_shared<MgmModel>();
+    std::vector<std::shared_ptr<GmModel>> gm_models;
+    if (infile.is_mapped()) {
+        gm_models = details::parse_blocks(infile, details::find_blocks(infile.contents()), unary_constant);
+    }
+    else {
+        // Streams can only be read once, so the models are parsed in order, all into one arena.
+        auto arena = std::make_shared<ModelArena>();
+        std::string_view line;
+        while (reader.next_line(line)) {
+            int g1_id = 0;
+            int g2_id = 0;
+            if (details::parse_gm_header(line, g1_id, g2_id)) {
+                gm_models.push_back(details::parse_gm(reader, g1_id, g2_id, unary_constant, arena));
+            }
+        }
+        arena->seal();
+    }
 
     int max_graph_id = 0;
-    while (std::getline(infile, line)) {
-        if (std::regex_match(line, re_match, re_gm)) {
-            int g1_id = std::stoi(re_match[1]);
-            int g2_id = std::stoi(re_match[2]);
-            if (g2_id > max_graph_id) {
-                max_graph_id = g2_id;
-                model->graphs.resize(max_graph_id+1);
+    for (const auto& gmModel : gm_models) {
+        int g1_id = gmModel->graph1.id;
+        int g2_id = gmModel->graph2.id;
+        if (g2_id > max_graph_id) {
+            max_graph_id = g2_id;
+            model->graphs.resize(max_graph_id+1);
+        }
+        spdlog::info("Graph {} and Graph {}", g1_id, g2_id);
+
+        model->graphs[g1_id] = gmModel->graph1;
+        model->graphs[g2_id] = gmModel->graph2;
+
+        model->add_model(gmModel);
+    }
+    model->no_graphs = max_graph_id + 1;
+
+    spdlog::info("Finished parsing model.\n");
+    return model;
+}
+
+namespace details {
+// Parses the model of a graph pair out of a mapped .dd file on access.
+// Every load reads the mapping through its own LineReader, so that pairs can be loaded concurrently.
+class DdModelLoader : public ModelLoader {
+    public:
+        DdModelLoader(std::unique_ptr<DdFile> file, std::vector<DdBlock> blocks, double unary_constant)
+            : file(std::move(file)), unary_constant(unary_constant) {
+            for (const auto& block : blocks) {
+                this->blocks[GmModelIdx(block.g1_id, block.g2_id)] = block;
             }
-            spdlog::info("Graph {} and Graph {}", g1_id, g2_id);
+        }
 
-            auto gmModel = details::parse_gm(infile, g1_id, g2_id, unary_constant);
+        std::shared_ptr<GmModel> load(int g1, int g2) override {
+            const auto& block = this->blocks.at(GmModelIdx(g1, g2));
+            LineReader reader(block.first, block.last);
+            return parse_gm(reader, g1, g2, this->unary_constant);
+        }
 
-            model->graphs[g1_id] = gmModel->graph1;
-            model->graphs[g2_id] = gmModel->graph2;
+    private:
+        std::unique_ptr<DdFile> file; // Keeps the blocks mapped
+        std::unordered_map<GmModelIdx, DdBlock, GmModelIdxHash> blocks;
+        double unary_constant;
+};
+
+std::shared_ptr<MgmModel> open_lazy_dd(fs::path dd_file, size_t memory_budget, double unary_constant) {
+    auto infile = std::make_unique<DdFile>(dd_file, DdFile::Access::random);
+    if (!infile->is_mapped()) {
+        spdlog::error("Lazy loading needs an uncompressed, regular file: {}", dd_file.string());
+        throw std::invalid_argument("Lazy loading needs an uncompressed, regular file: " + dd_file.string());
+    }
+    auto blocks = find_blocks(infile->contents());
 
-            GmModelIdx idx(g1_id, g2_id);
-            model->models[idx] = gmModel;
+    // Graph sizes are taken from the "p" line of each model. Costs are not parsed yet.
+    auto model = std::make_shared<MgmModel>();
+    std::vector<GmModelIdx> keys;
+    for (const auto& block : blocks) {
+        LineReader reader(block.first, block.last);
+        std::string_view line;
+        int no_left = 0;
+        int no_right = 0;
+        try {
+            if (!reader.next_line(line)) {
+                throw std::invalid_argument("Unexpected end of file.");
+            }
+            LineTokenizer header(line);
+            header.skip_token();
+            no_left     = header.next_int();
+            no_right    = header.next_int();
+        }
+        catch (const std::invalid_argument& e) {
+            spdlog::error("Failed to parse model ({} {}) in line 1 after its header: {}", block.g1_id, block.g2_id, e.what());
+            throw std::invalid_argument(fmt::format("Model ({} {}), line 1 after its header: {}", block.g1_id, block.g2_id, e.what()));
         }
+
+        if (block.g2_id >= (int) model->graphs.size()) {
+            model->graphs.resize(block.g2_id + 1);
+        }
+        model->graphs[block.g1_id] = Graph(block.g1_id, no_left);
+        model->graphs[block.g2_id] = Graph(block.g2_id, no_right);
+        keys.emplace_back(block.g1_id, block.g2_id);
     }
-    model->no_graphs = max_graph_id + 1;
+    model->no_graphs = model->graphs.size();
+    model->set_loader(std::make_shared<DdModelLoader>(std::move(infile), std::move(blocks), unary_constant), std::move(keys), memory_budget);
 
-    spdlog::info("Finished parsing model.\n");
+    return model;
+}
+}
+
+std::shared_ptr<MgmModel> open_lazy(fs::path model_file, size_t memory_budget, double unary_constant) {
+    if (unary_constant != 0.0) {
+        spdlog::info("Loading model with custom unary constant: {}", unary_constant);
+    }
+    std::shared_ptr<MgmModel> model;
+    if (model_file.extension() == ".mgmb") {
+        model = details::open_lazy_binary(model_file, memory_budget, unary_constant);
+    }
+    else {
+        model = details::open_lazy_dd(model_file, memory_budget, unary_constant);
+    }
+    spdlog::info("Indexed {} models. Models are loaded on first access.", model->model_keys().size());
     return model;
 }
 
 void export_dd_file(fs::path dd_file, std::shared_ptr<MgmModel> model)
 {
     spdlog::info("Exporting model as .dd file.\n");
-    std::ofstream outfile(dd_file);
-    outfile << std::setprecision(16);
+    std::ofstream outfile(dd_file, std::ios::binary);
+    if (!outfile) {
+        spdlog::error("Could not open file: {}", dd_file.string());
+        throw std::invalid_argument("Could not open file: " + dd_file.string());
+    }
+
+    // Sort keys of models for exporting
+    std::vector<GmModelIdx> keys = model->model_keys();
+    std::sort(keys.begin(), keys.end());
 
     // Edge case, just one model present.
-    if (model->models.size() == 1){
-        auto gm_model = model->models.begin()->second;
-        details::write_model(outfile, gm_model);
+    if (keys.size() == 1){
+        fmt::memory_buffer buffer;
+        details::write_model(buffer, *model->gm_model(keys[0].first, keys[0].second));
+        outfile.write(buffer.data(), buffer.size());
 
         outfile.close();
         return;
     }
-    
-    // Sort keys of models for exporting
-    std::vector<GmModelIdx> keys;
-    for (const auto& pair : model->models) {
-        keys.push_back(pair.first);
-    }
-    std::sort(keys.begin(), keys.end());
 
-    for (const auto& gm_model_idx : keys) {
-        auto m = model->models[gm_model_idx];
-        spdlog::info("Exporting pair ({} {})", m->graph1.id, m->graph2.id);
-        outfile << "gm " << m->graph1.id << " " << m->graph2.id << "\n";
-        details::write_model(outfile, m);
+    // Pairs are formatted in parallel, a batch at a time, and written in order.
+    // Batches limit the memory held by formatted, but not yet written pairs.
+    const size_t batch_size = 2 * (size_t) omp_get_max_threads();
+    std::vector<fmt::memory_buffer> buffers(batch_size);
+    std::vector<std::shared_ptr<GmModel>> batch_models(batch_size);
+
+    for (size_t batch_start = 0; batch_start < keys.size(); batch_start += batch_size) {
+        size_t batch_end = std::min(batch_start + batch_size, keys.size());
+
+        // Lazy models are loaded outside of the parallel region, where exceptions can't propagate.
+        for (size_t i = batch_start; i < batch_end; i++) {
+            batch_models[i - batch_start] = model->gm_model_at(keys[i].first, keys[i].second);
+        }
+
+        #pragma omp parallel for schedule(dynamic)
+        for (size_t i = batch_start; i < batch_end; i++) {
+            auto& buffer = buffers[i - batch_start];
+            buffer.clear();
+
+            const auto& m = batch_models[i - batch_start];
+            // GmModels of a view carry the graph ids of the root model. The exported graphs are those of the view.
+            fmt::format_to(std::back_inserter(buffer), "gm {} {}\n", keys[i].first, keys[i].second);
+            details::write_model(buffer, *m);
+        }
+
+        for (size_t i = batch_start; i < batch_end; i++) {
+            spdlog::info("Exporting pair ({} {})", keys[i].first, keys[i].second);
+            const auto& buffer = buffers[i - batch_start];
+            outfile.write(buffer.data(), buffer.size());
+        }
     }
 
     outfile.close();
+    if (!outfile) {
+        spdlog::error("Failed to write {}", dd_file.string());
+        throw std::runtime_error("Failed to write " + dd_file.string());
+    }
     spdlog::info("Finished exporting.\n");
 }
 
@@ -137,40 +281,79 @@ json null_valued_labeling(const std::vector<int>& l) {
     return new_l;
 }
 
-void save_to_disk(fs::path outPath, const MgmSolution& solution) {
-   json j;
+// Written pair by pair, without building a json document first.
+// Labelings are written on a single line each, unassigned nodes as null.
+void save_to_disk(fs::path outPath, const MgmSolution& solution, bool compute_energy) {
+    if (fs::is_directory(outPath)) {
+        outPath = outPath / "solution.json";
+    }
+    if (outPath.extension() != ".json") {
+        outPath.replace_extension(".json");
+    }
+    fs::create_directories(outPath.parent_path());
+
+    std::ofstream o(outPath, std::ios::binary);
+    if (!o) {
+        spdlog::error("Could not open file: {}", outPath.string());
+        throw std::invalid_argument("Could not open file: " + outPath.string());
+    }
+
+    fmt::memory_buffer buffer;
+    auto it = std::back_inserter(buffer);
+    auto flush = [&o, &buffer]() {
+        o.write(buffer.data(), buffer.size());
+        buffer.clear();
+    };
 
     // energy
-    j["energy"] = solution.evaluate();
-    
+    double energy = compute_energy ? solution.evaluate() : std::numeric_limits<double>::quiet_NaN();
+    if (std::isfinite(energy)) {
+        fmt::format_to(it, "{{\n    \"energy\": {},\n", energy);
+    }
+    else {
+        fmt::format_to(it, "{{\n    \"energy\": null,\n");
+    }
+
     // Number of nodes per graph:
-    std::vector<int> graph_sizes;
-    for (const auto & g : solution.model->graphs) {
-        graph_sizes.push_back(g.no_nodes);
+    fmt::format_to(it, "    \"graph orders\": [");
+    for (size_t g = 0; g < solution.model->graphs.size(); g++) {
+        fmt::format_to(it, g == 0 ? "{}" : ", {}", solution.model->graphs[g].no_nodes);
     }
-    j["graph orders"] = graph_sizes;
+    fmt::format_to(it, "],\n");
 
     // labeling
-    for (auto const& [key, gm_labeling] : solution.labeling()) {
-        json json_labeling = null_valued_labeling(gm_labeling);
+    const auto& labeling = solution.dense_labeling();
+    const auto& keys = labeling.keys(); // Ordered by graph ids
 
-        std::string key_string = fmt::format("{}, {}", key.first, key.second);
-        j["labeling"][key_string] = json_labeling; 
-    }
+    fmt::format_to(it, "    \"labeling\": {{");
+    for (size_t k = 0; k < keys.size(); k++) {
+        fmt::format_to(it, "{}\n        \"{}, {}\": [", (k == 0) ? "" : ",", keys[k].first, keys[k].second);
 
-    spdlog::debug("Saving solution to disk: {}", j.dump());
+        const int* gm_labeling = labeling.at(keys[k]);
+        for (int i = 0; i < labeling.size(keys[k]); i++) {
+            if (i > 0) {
+                fmt::format_to(it, ", ");
+            }
+            if (gm_labeling[i] == -1) {
+                fmt::format_to(it, "null");
+            } else {
+                fmt::format_to(it, "{}", gm_labeling[i]);
+            }
+        }
+        fmt::format_to(it, "]");
 
-    if (fs::is_directory(outPath)) {
-        outPath = outPath / "solution.json";
-    }
-    if (outPath.extension() != ".json") {
-        outPath.replace_extension(".json");
+        if (buffer.size() > (1 << 20)) {
+            flush();
+        }
     }
-    fs::create_directories(outPath.parent_path());
+    fmt::format_to(it, "\n    }}\n}}\n");
+    flush();
 
-    std::ofstream o(outPath);
-    o << std::setw(4) << j << "\n";
     o.close();
+    if (!o) {
+        spdlog::error("Failed to write {}", outPath.string());
+        throw std::runtime_error("Failed to write " + outPath.string());
+    }
 }
 
 void save_to_disk(fs::path outPath, const GmSolution &solution) {
@@ -201,137 +384,544 @@ void save_to_disk(fs::path outPath, const GmSolution &solution) {
     o.close();
 }
 
-GmModelIdx from_json(const std::string input) {
-    std::string g1, g2;
-    std::istringstream ss(input);
-    
-    std::getline(ss, g1, ',');
-    std::getline(ss, g2, ',');
+// Header lines, followed by one line per clique:
+//   cliques <no_graphs> <no_cliques>
+//   energy <energy>                            Omitted, if the energy was not computed
+//   <graph> <node> <graph> <node> ...
+void save_clique_table(fs::path outPath, const MgmSolution& solution, bool compute_energy) {
+    if (fs::is_directory(outPath)) {
+        outPath = outPath / "solution.cliques";
+    }
+    if (outPath.extension() != ".cliques") {
+        outPath.replace_extension(".cliques");
+    }
+    fs::create_directories(outPath.parent_path());
+
+    std::ofstream o(outPath, std::ios::binary);
+    if (!o) {
+        spdlog::error("Could not open file: {}", outPath.string());
+        throw std::invalid_argument("Could not open file: " + outPath.string());
+    }
+
+    const auto& clique_table = solution.clique_table();
 
-    return GmModelIdx(std::stoi(g1), std::stoi(g2));
+    fmt::memory_buffer buffer;
+    auto it = std::back_inserter(buffer);
+    fmt::format_to(it, "cliques {} {}\n", clique_table.no_graphs, clique_table.no_cliques);
+    if (compute_energy) {
+        fmt::format_to(it, "energy {}\n", solution.evaluate());
+    }
+
+    for (const auto& clique : clique_table) {
+        bool first = true;
+        for (const auto& [graph_id, node_id] : clique) {
+            fmt::format_to(it, first ? "{} {}" : " {} {}", graph_id, node_id);
+            first = false;
+        }
+        fmt::format_to(it, "\n");
+
+        if (buffer.size() > (1 << 20)) {
+            o.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    o.write(buffer.data(), buffer.size());
+
+    o.close();
+    if (!o) {
+        spdlog::error("Failed to write {}", outPath.string());
+        throw std::runtime_error("Failed to write " + outPath.string());
+    }
 }
 
-MgmSolution import_from_disk(fs::path labeling_path, std::shared_ptr<MgmModel> model) {
+MgmSolution import_clique_table(fs::path solution_path, std::shared_ptr<MgmModel> model) {
+    details::DdFile infile(solution_path);
+    auto& reader = infile.reader();
+
+    auto invalid = [&reader, &solution_path](const std::string& message) {
+        spdlog::error("Invalid clique table in line {}: {}", reader.line_number(), message);
+        return std::invalid_argument(fmt::format("{}, line {}: {}", solution_path.string(), reader.line_number(), message));
+    };
+
+    const auto& graphs = model->graphs;
+    std::string_view line;
+    CliqueTable table(model->no_graphs);
+
+    // Clique of every node, to detect nodes in multiple cliques.
+    std::vector<std::vector<int>> node_clique_idx;
+    long long no_nodes_total = 0;
+    for (const auto& g : graphs) {
+        node_clique_idx.emplace_back(g.no_nodes, -1);
+        no_nodes_total += g.no_nodes;
+    }
+
+    try {
+        if (!reader.next_line(line) || line.substr(0, 8) != "cliques ") {
+            throw std::invalid_argument("Expected 'cliques <no_graphs> <no_cliques>'.");
+        }
+        details::LineTokenizer header(line);
+        header.skip_token();
+        int no_graphs   = header.next_int();
+        int no_cliques  = header.next_int();
+        if (no_graphs != model->no_graphs) {
+            throw std::invalid_argument("Number of graphs does not match the model.");
+        }
+        // Every clique holds at least one node, and every node is part of at most one clique.
+        if (no_cliques < 0 || no_cliques > no_nodes_total) {
+            throw std::invalid_argument(fmt::format("Invalid number of cliques: {}.", no_cliques));
+        }
+        table.reserve(no_cliques);
+
+        while (reader.next_line(line)) {
+            if (line.substr(0, 7) == "energy ") {
+                spdlog::debug("Energy according to file: {}", line.substr(7));
+                continue;
+            }
+
+            details::LineTokenizer tokens(line);
+            if (tokens.at_end())
+                continue;
+
+            CliqueTable::Clique clique;
+            while (!tokens.at_end()) {
+                int graph_id = tokens.next_int();
+                int node_id = tokens.next_int();
+
+                if (graph_id < 0 || graph_id >= model->no_graphs || node_id < 0 || node_id >= graphs[graph_id].no_nodes) {
+                    throw std::invalid_argument(fmt::format("Node {} of graph {} does not exist in the model.", node_id, graph_id));
+                }
+                if (!clique.emplace(graph_id, node_id).second) {
+                    throw std::invalid_argument(fmt::format("Graph {} appears twice in the clique.", graph_id));
+                }
+                if (node_clique_idx[graph_id][node_id] >= 0) {
+                    throw std::invalid_argument(fmt::format("Node {} of graph {} is part of two cliques.", node_id, graph_id));
+                }
+                node_clique_idx[graph_id][node_id] = table.no_cliques;
+            }
+            table.add_clique(std::move(clique));
+        }
+    }
+    catch (const std::invalid_argument& e) {
+        throw invalid(e.what());
+    }
+
+    // Nodes not listed are unmatched.
+    for (size_t graph_id = 0; graph_id < node_clique_idx.size(); graph_id++) {
+        for (size_t node_id = 0; node_id < node_clique_idx[graph_id].size(); node_id++) {
+            if (node_clique_idx[graph_id][node_id] >= 0)
+                continue;
+            CliqueTable::Clique c;
+            c[graph_id] = node_id;
+            table.add_clique(std::move(c));
+        }
+    }
+
     MgmSolution s(model);
-    Labeling l = s.create_empty_labeling();
+    s.set_solution(std::move(table));
+    return s;
+}
 
-    spdlog::info("Parsing json");
-    std::ifstream ifs(labeling_path);
-    json j = json::parse(ifs);
+namespace details {
+// Reads a json solution (see save_to_disk) without building a json document.
+// Labels are written directly into a labeling created by MgmSolution::create_empty_dense_labeling.
+class LabelingSaxHandler : public nlohmann::json_sax<json> {
+    public:
+        LabelingSaxHandler(DenseLabeling& labeling, const std::vector<Graph>& graphs) : labeling(labeling), graphs(graphs) {}
+
+        bool found_labeling = false;
+        double energy = std::numeric_limits<double>::quiet_NaN();
+
+        bool null() override                                        { return this->label(-1); }
+        bool boolean(bool) override                                 { return this->unexpected("boolean"); }
+        bool number_integer(number_integer_t val) override          { return this->number(val); }
+        bool number_unsigned(number_unsigned_t val) override        { return this->number(val); }
+        bool number_float(number_float_t val, const string_t&) override {
+            if (this->is_energy()) {
+                this->energy = val;
+                return true;
+            }
+            return this->unexpected("float");
+        }
+        bool string(string_t&) override                             { return this->unexpected("string"); }
+        bool binary(binary_t&) override                             { return this->unexpected("binary"); }
+
+        bool start_object(std::size_t) override {
+            this->depth++;
+            if (this->depth == 2 && this->top_level_key == "labeling") {
+                this->found_labeling = true;
+            }
+            return true;
+        }
+        bool end_object() override {
+            this->depth--;
+            return true;
+        }
+        bool start_array(std::size_t) override {
+            this->depth++;
+            return true;
+        }
+        bool end_array() override {
+            this->depth--;
+            this->gm_labeling = nullptr;
+            return true;
+        }
+
+        bool key(string_t& val) override {
+            if (this->depth == 1) {
+                this->top_level_key = val;
+            }
+            else if (this->depth == 2 && this->top_level_key == "labeling") {
+                auto idx = parse_key(val);
+                if (!this->labeling.contains(idx)) 
+                    throw std::invalid_argument("Provided model does not contain graph pair contained in labeling");
+
+                this->gm_labeling = this->labeling.at(idx);
+                this->gm_idx = idx;
+                this->no_nodes = this->labeling.size(idx);
+                this->no_labels = this->graphs[idx.second].no_nodes;
+                this->node = 0;
+            }
+            return true;
+        }
 
-    for (auto& [key, arr] : j.at("labeling").items()) {
-        GmModelIdx idx = from_json(key);
+        bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+            throw std::invalid_argument(fmt::format("Invalid json solution file at byte {}: {}", position, ex.what()));
+        }
 
-        if (l.find(idx) == l.end()) 
-            throw std::invalid_argument("Provided model does not contain graph pair contained in labeling");
+    private:
+        DenseLabeling& labeling;
+        const std::vector<Graph>& graphs;
+        int* gm_labeling = nullptr; // Labeling of the current array. Null outside of "labeling".
+        GmModelIdx gm_idx;
+        int no_nodes = 0;
+        int no_labels = 0;
+        int node = 0;
 
-        auto& gm_labeling = l[idx];
+        int depth = 0;
+        std::string top_level_key;
 
-        int i = 0;
-        for (auto& val : arr) {
-            if (!val.is_null())
-                gm_labeling[i] = val.template get<int>();
-            i++;
+        bool is_energy() const {
+            return this->depth == 1 && this->top_level_key == "energy";
         }
-    }
-    s.set_solution(l);
 
-    if (!j.at("energy").is_null()){
-        double j_energy = j.at("energy").template get<double>();
-        spdlog::debug("Energy according to json: {}", j_energy);
+        template <typename T>
+        bool number(T val) {
+            if (this->is_energy()) {
+                this->energy = static_cast<double>(val);
+                return true;
+            }
+            if (this->depth == 3 && this->gm_labeling) {
+                // Checked before the cast, so that large values can't wrap into the range.
+                bool in_range;
+                if constexpr (std::is_signed_v<T>) {
+                    in_range = (val >= -1 && val < this->no_labels);
+                }
+                else {
+                    in_range = (val < static_cast<T>(this->no_labels));
+                }
+                if (!in_range) {
+                    throw std::invalid_argument(fmt::format("Label {} out of range in graph pair ({} {}).", val, this->gm_idx.first, this->gm_idx.second));
+                }
+            }
+            return this->label(static_cast<int>(val));
         }
-    else {
-        spdlog::debug("Energy according to json: null");
+
+        // Values outside of "labeling" are ignored.
+        bool label(int val) {
+            if (this->depth == 3 && this->gm_labeling) {
+                if (this->node >= this->no_nodes) {
+                    throw std::invalid_argument("Labeling is longer than the number of nodes in its graph.");
+                }
+                this->gm_labeling[this->node++] = val;
+            }
+            return true;
+        }
+
+        bool unexpected(const char* type) {
+            if (this->depth == 3 && this->gm_labeling) {
+                throw std::invalid_argument(fmt::format("Unexpected {} in labeling.", type));
+            }
+            return true;
+        }
+
+        // "<g1>, <g2>"
+        static GmModelIdx parse_key(const std::string& key) {
+            int g1 = -1;
+            int g2 = -1;
+            const char* first = key.data();
+            const char* last = key.data() + key.size();
+
+            auto r1 = std::from_chars(first, last, g1);
+            first = r1.ptr;
+            while (first != last && (*first == ',' || *first == ' ')) {
+                first++;
+            }
+            auto r2 = std::from_chars(first, last, g2);
+            if (r1.ec != std::errc() || r2.ec != std::errc()) {
+                throw std::invalid_argument("Invalid graph pair in labeling: " + key);
+            }
+            return GmModelIdx(g1, g2);
+        }
+};
+}
+
+MgmSolution import_from_disk(fs::path labeling_path, std::shared_ptr<MgmModel> model) {
+    if (labeling_path.extension() == ".mgms") {
+        return import_binary_solution(labeling_path, model);
+    }
+    if (labeling_path.extension() == ".cliques") {
+        return import_clique_table(labeling_path, model);
     }
+    MgmSolution s(model);
+    DenseLabeling l = s.create_empty_dense_labeling();
+
+    spdlog::info("Parsing json");
+    std::ifstream ifs(labeling_path, std::ios::binary);
+    if (!ifs) {
+        spdlog::error("Could not open file: {}", labeling_path.string());
+        throw std::invalid_argument("Could not open file: " + labeling_path.string());
+    }
+    // Parsed straight from the stream, the file is never held in memory.
+    details::LabelingSaxHandler handler(l, model->graphs);
+    json::sax_parse(ifs, &handler);
+    if (!handler.found_labeling) {
+        throw std::invalid_argument("Solution file does not contain a labeling: " + labeling_path.string());
+    }
+    s.set_solution(std::move(l));
 
-    spdlog::debug("Energy of parsed model: {}", s.evaluate());
+    spdlog::debug("Energy according to json: {}", handler.energy);
+    if (spdlog::should_log(spdlog::level::debug)) {
+        spdlog::debug("Energy of parsed model: {}", s.evaluate());
+    }
     return s;
 }
 
 namespace details {
-    void write_model(std::ofstream& outfile, std::shared_ptr<GmModel> model) {
-        
-        outfile << "p "
-                << model->graph1.no_nodes << " "
-                << model->graph2.no_nodes << " "
-                << model->no_assignments() << " "
-                << model->no_edges() << "\n";
-
-        // Cache the assignment id for writing.
-        // Needs to be looked up for edges
-        ankerl::unordered_dense::map<AssignmentIdx, int, AssignmentIdxHash> assignment_ids;
-
-        int a_id = 0;
-        for (const auto& a_idx : model->assignment_list) {
-            auto & cost = model->costs->unary(a_idx);
-            outfile << "a "
-                    << a_id << " " 
-                    << a_idx.first << " " 
-                    << a_idx.second << " " 
-                    << cost << "\n";
-
-            assignment_ids[a_idx] = a_id;
-            a_id++;
+    // Costs are written in their shortest representation that parses back to the same value.
+    void write_model(fmt::memory_buffer& out, const GmModel& model) {
+        auto it = std::back_inserter(out);
+
+        fmt::format_to(it, "p {} {} {} {}\n", 
+                        model.graph1.no_nodes, 
+                        model.graph2.no_nodes, 
+                        model.no_assignments(), 
+                        model.no_edges());
+
+        const auto& unaries = model.costs->unary_costs();
+        for (size_t a_id = 0; a_id < model.assignment_list.size(); a_id++) {
+            const auto& [node1, node2] = model.assignment_list[a_id];
+            fmt::format_to(it, "a {} {} {} {}\n", a_id, node1, node2, unaries[a_id]);
         }
         
-        for (const auto& [edge_idx, cost] : model->costs->all_edges()) {
-            outfile << "e "
-                    << assignment_ids[edge_idx.first]   << " " 
-                    << assignment_ids[edge_idx.second]  << " " 
-                    << cost << "\n";
+        // Edges are keyed by assignment ids already.
+        model.costs->for_each_edge([&](EdgeKey edge_key, CostValue cost) {
+            fmt::format_to(it, "e {} {} {}\n", edge_key.first, edge_key.second, cost);
+        });
+    }
+
+// Matches "gm <graph1_id> <graph2_id>". Other lines between the models are ignored.
+bool parse_gm_header(std::string_view line, int& g1_id, int& g2_id) {
+    if (line.substr(0, 3) != "gm ")
+        return false;
+
+    LineTokenizer tokens(line.substr(3));
+    try {
+        g1_id = tokens.next_int();
+        g2_id = tokens.next_int();
+    } catch (const std::invalid_argument&) {
+        return false;
+    }
+    return tokens.at_end() && g1_id >= 0 && g2_id >= 0;
+}
+
+// Pre-scan for the "gm" headers. Only lines starting with "gm " are looked at.
+std::vector<DdBlock> find_blocks(std::string_view contents) {
+    std::vector<DdBlock> blocks;
+    const char* data = contents.data();
+
+    size_t line_start = 0;
+    while (line_start < contents.size()) {
+        if (contents.compare(line_start, 3, "gm ") == 0) {
+            size_t line_end = std::min(contents.find('\n', line_start), contents.size());
+            auto header = contents.substr(line_start, line_end - line_start);
+            if (!header.empty() && header.back() == '\r') {
+                header.remove_suffix(1);
+            }
+
+            int g1_id = 0;
+            int g2_id = 0;
+            if (parse_gm_header(header, g1_id, g2_id)) {
+                if (!blocks.empty()) {
+                    blocks.back().last = data + line_start;
+                }
+                size_t body_start = std::min(line_end + 1, contents.size());
+                blocks.push_back(DdBlock{g1_id, g2_id, data + body_start, data + contents.size()});
+            }
         }
+
+        size_t next = contents.find("\ngm ", line_start);
+        if (next == std::string_view::npos)
+            break;
+        line_start = next + 1;
     }
+    return blocks;
+}
 
-std::shared_ptr<GmModel> parse_gm(std::ifstream& dd_file, int g1_id, int g2_id, double unary_constant) {
-    std::string line = "";
-    std::stringstream lineStream;
+// Blocks are independent of each other and parsed in parallel. Models are returned in file order.
+// Every thread allocates the models it parses from an arena of its own, so no allocator is shared between threads
+// and a whole model file lives in a few large blocks per thread.
+std::vector<std::shared_ptr<GmModel>> parse_blocks(const DdFile& file, const std::vector<DdBlock>& blocks, double unary_constant) {
+    std::vector<std::shared_ptr<GmModel>> gm_models(blocks.size());
+    std::vector<std::exception_ptr> errors(blocks.size());
+    std::vector<std::shared_ptr<ModelArena>> arenas;
+
+    // The frozen layout and adjacency of a model take somewhat less than the bytes of its text (about 4/5 for house).
+    // Edges dominate, so single precision costs need about 2/3 of that.
+    // A thread's first block fits its share of the file, as a second block would be larger than the first.
+    size_t text_bytes = 0;
+    for (const auto& block : blocks) {
+        text_bytes += block.last - block.first;
+    }
+    size_t data_bytes = text_bytes * (sizeof(int) + sizeof(CostValue)) / (sizeof(int) + sizeof(double));
+
+    #pragma omp parallel
+    #pragma omp single
+    {
+        int no_threads = omp_get_num_threads();
+        spdlog::debug("Parsing {} models with {} threads.", blocks.size(), no_threads);
+        // Blocks are only allocated on first use, so threads without a task don't reserve anything.
+        size_t arena_size = std::max<size_t>(data_bytes / (size_t) no_threads, 1 << 16);
+        for (int t = 0; t < no_threads; t++) {
+            arenas.push_back(std::make_shared<ModelArena>(arena_size));
+        }
 
-    // metadata of GM problem
-    // p N0 N1 A E
-    std::getline(dd_file, line);
-    lineStream.clear();
-    lineStream.str(line.substr(2));
-    int no_left = 0;
-    int no_right = 0;
-    int no_a = 0;
-    int no_e = 0;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            #pragma omp task firstprivate(i) shared(file, blocks, gm_models, errors, arenas)
+            {
+                file.will_need(blocks[i].first, blocks[i].last);
+
+                // Exceptions must not leave the task.
+                // Tasks are tied and parse_gm has no scheduling point, so a thread works on one task at a time.
+                try {
+                    LineReader reader(blocks[i].first, blocks[i].last);
+                    const auto& arena = arenas[omp_get_thread_num()];
+                    gm_models[i] = parse_gm(reader, blocks[i].g1_id, blocks[i].g2_id, unary_constant, arena);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        }
+    }
+    for (const auto& arena : arenas) {
+        arena->seal();
+    }
 
-    lineStream >> no_left >> no_right >> no_a >> no_e;
-    
-    Graph g1(g1_id, no_left);
-    Graph g2(g2_id, no_right);
-
-    auto gmModel = std::make_shared<GmModel>(g1, g2, no_a, no_e);
-
-    int ass_id = 0;
-    int id1 = 0;
-    int id2 = 0;
-    double c = 0.0;
-
-    // Assignments
-    // a A iA jA cA
-    for (auto i = 0; i < no_a; i++) {
-        std::getline(dd_file, line);
-        lineStream.clear();
-        lineStream.str(line.substr(2));
-        lineStream >> ass_id >> id1 >> id2 >> c;
-
-        assert ((size_t) ass_id == gmModel->assignment_list.size());
-        gmModel->add_assignment(id1, id2, (c + unary_constant) );
-    }
-
-    // Edges
-    // e a1 a′1 d1
-    for (auto i = 0; i < no_e; i++) {
-        std::getline(dd_file, line);
-        lineStream.clear();
-        lineStream.str(line.substr(2));
-        lineStream >> id1 >> id2 >> c;
-        
-        gmModel->add_edge(id1, id2, c);
+    for (const auto& e : errors) {
+        if (e)
+            std::rethrow_exception(e);
     }
+    return gm_models;
+}
+
+std::shared_ptr<GmModel> parse_gm(LineReader& reader, int g1_id, int g2_id, double unary_constant, std::shared_ptr<ModelArena> arena) {
+    size_t first_line = reader.line_number();
+    std::string_view line;
+    auto next_line = [&reader, &line]() {
+        if (!reader.next_line(line)) {
+            throw std::invalid_argument("Unexpected end of file.");
+        }
+        return LineTokenizer(line);
+    };
+
+    try {
+        // metadata of GM problem
+        // p N0 N1 A E
+        auto header = next_line();
+        header.skip_token();
+        int no_left     = header.next_int();
+        int no_right    = header.next_int();
+        int no_a        = header.next_int();
+        int no_e        = header.next_int();
+
+        Graph g1(g1_id, no_left);
+        Graph g2(g2_id, no_right);
+
+        auto gmModel = std::make_shared<GmModel>(g1, g2, 0, 0, arena);
+        auto* resource = gmModel->assignment_list.get_allocator().resource();
+
+        // The frozen layout is filled directly, no hash maps are built (see GmModel::assign_frozen).
+        // Assignments
+        // a A iA jA cA
+        std::pmr::vector<AssignmentIdx> assignments(resource);
+        std::pmr::vector<CostValue> unaries(resource);
+        assignments.reserve(no_a);
+        unaries.reserve(no_a);
+        for (auto i = 0; i < no_a; i++) {
+            auto tokens = next_line();
+            tokens.skip_token();
+            int ass_id  = tokens.next_int();
+            int id1     = tokens.next_int();
+            int id2     = tokens.next_int();
+            double c    = tokens.next_double();
+
+            // Edges refer to assignments by position, so ids have to be sequential.
+            if (ass_id != i) {
+                throw std::invalid_argument(fmt::format("Expected assignment id {}, got {}.", i, ass_id));
+            }
+            assignments.emplace_back(id1, id2);
+            unaries.push_back(static_cast<CostValue>(c + unary_constant));
+        }
 
-    return gmModel;
+        // Edges
+        // e a1 a′1 d1
+        std::vector<EdgeKey> edge_keys;
+        std::vector<CostValue> edge_costs;
+        edge_keys.reserve(no_e);
+        edge_costs.reserve(no_e);
+        for (auto i = 0; i < no_e; i++) {
+            auto tokens = next_line();
+            tokens.skip_token();
+            int id1     = tokens.next_int();
+            int id2     = tokens.next_int();
+            double c    = tokens.next_double();
+
+            if (id1 < 0 || id1 >= no_a || id2 < 0 || id2 >= no_a) {
+                throw std::out_of_range("Can't add edge. Assignment id out of range.");
+            }
+            edge_keys.push_back(CostMap::edge_key(id1, id2));
+            edge_costs.push_back(static_cast<CostValue>(c));
+        }
+
+        // Counting sort into the rows of the smaller assignment id.
+        EdgeCSR csr(resource);
+        csr.offsets.assign(no_a + 1, 0);
+        for (const auto& key : edge_keys) {
+            csr.offsets[key.first + 1]++;
+        }
+        std::partial_sum(csr.offsets.begin(), csr.offsets.end(), csr.offsets.begin());
+
+        csr.neighbours.resize(edge_keys.size());
+        csr.costs.resize(edge_keys.size());
+        std::vector<int> row_end(csr.offsets.begin(), csr.offsets.end() - 1);
+        for (size_t i = 0; i < edge_keys.size(); i++) {
+            int pos = row_end[edge_keys[i].first]++;
+            csr.neighbours[pos] = edge_keys[i].second;
+            csr.costs[pos]      = edge_costs[i];
+        }
+        csr.sort_rows();
+        csr.merge_duplicates(); // Like add_edge, a repeated edge overwrites the earlier one.
+
+        gmModel->assign_frozen(std::move(assignments), std::move(unaries), std::move(csr));
+
+        return gmModel;
+    } 
+    catch (const std::logic_error& e) {
+        // Malformed input (std::invalid_argument) and out of range ids (std::out_of_range) are both reported as invalid input.
+        // Models may be parsed out of order, so lines are counted from the "gm" header of the model.
+        size_t line_no = reader.line_number() - first_line;
+        spdlog::error("Failed to parse model ({} {}) in line {} after its header: {}", g1_id, g2_id, line_no, e.what());
+        throw std::invalid_argument(fmt::format("Model ({} {}), line {} after its header: {}", g1_id, g2_id, line_no, e.what()));
+    }
 }
 }
 }
\ No newline at end of file
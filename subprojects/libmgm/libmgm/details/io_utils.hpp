@@ -13,8 +13,29 @@ std::shared_ptr<GmModel> parse_dd_file_gm(std::filesystem::path dd_file, double
 
 void export_dd_file(std::filesystem::path dd_file, std::shared_ptr<MgmModel> model);
 
-void save_to_disk(std::filesystem::path outPath, const MgmSolution& solution);
+// Binary model format (.mgmb) with an index of all graph pairs. Much faster to load than .dd files.
+std::shared_ptr<MgmModel> parse_binary(std::filesystem::path mgmb_file, double unary_constant=0.0);
+void export_binary(std::filesystem::path mgmb_file, std::shared_ptr<MgmModel> model);
+
+// Indexes a .dd or .mgmb file without loading the costs. Models of graph pairs are loaded on first access.
+// If `memory_budget` (in bytes) is non-zero, the least recently used models are dropped to stay within the budget.
+// The file must not be modified while the model is in use.
+std::shared_ptr<MgmModel> open_lazy(std::filesystem::path model_file, size_t memory_budget=0, double unary_constant=0.0);
+
+// Energy is stored as null, if `compute_energy` is false.
+void save_to_disk(std::filesystem::path outPath, const MgmSolution& solution, bool compute_energy=true);
 void save_to_disk(std::filesystem::path outPath, const GmSolution& solution);
+
+// Binary solution format (.mgms). Stores graph orders and one int32 label array per graph pair.
+void save_binary_solution(std::filesystem::path outPath, const MgmSolution& solution, bool compute_energy=true);
+MgmSolution import_binary_solution(std::filesystem::path solution_path, std::shared_ptr<MgmModel> model);
+
+// Clique table solution format (.cliques). Text, one clique per line as "<graph> <node> <graph> <node> ...".
+// Written straight from MgmSolution::clique_table() and loaded without converting to a pairwise labeling.
+void save_clique_table(std::filesystem::path outPath, const MgmSolution& solution, bool compute_energy=true);
+MgmSolution import_clique_table(std::filesystem::path solution_path, std::shared_ptr<MgmModel> model);
+
+// Reads json, binary (.mgms) or clique table (.cliques) solutions, by file extension.
 MgmSolution import_from_disk(std::filesystem::path labeling_path, std::shared_ptr<MgmModel> model);
 
 }
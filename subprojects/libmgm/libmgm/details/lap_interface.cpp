@@ -25,9 +25,12 @@ LAPSolver::LAPSolver(std::shared_ptr<GmModel> model)
     this->costs.resize(this->nr_rows * this->nr_cols, INFINITY);
     
     // Copy assignment costs to flat vector.
-    for (auto & a : model->costs->all_assignments()) {
-        size_t idx = a.first.first * this->nr_cols + a.first.second;
-        this->costs[idx] = a.second;
+    // Unary costs are stored by assignment id, no lookups needed.
+    const auto& unaries = model->costs->unary_costs();
+    for (size_t id = 0; id < unaries.size(); id++) {
+        const auto& a = model->assignment_list[id];
+        size_t idx = a.first * this->nr_cols + a.second;
+        this->costs[idx] = unaries[id];
     }
 
     // set assignments to dummies to zero
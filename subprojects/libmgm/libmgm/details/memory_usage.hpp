@@ -0,0 +1,74 @@
+#ifndef LIBMGM_MEMORY_USAGE_HPP
+#define LIBMGM_MEMORY_USAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mgm {
+
+// Memory footprint in bytes, broken down by component.
+// Sizes are computed from container capacities. Allocator and hash map bookkeeping is estimated.
+struct MemoryUsage {
+    std::vector<std::pair<std::string, size_t>> components;
+
+    // Adds to an existing component of the same name.
+    void add(const std::string& component, size_t bytes) {
+        for (auto& [name, b] : this->components) {
+            if (name == component) {
+                b += bytes;
+                return;
+            }
+        }
+        this->components.emplace_back(component, bytes);
+    }
+
+    // Adds all components of `other` as "<prefix>.<component>".
+    void add(const std::string& prefix, const MemoryUsage& other) {
+        for (const auto& [name, bytes] : other.components) {
+            this->add(prefix + "." + name, bytes);
+        }
+    }
+
+    size_t total() const {
+        size_t sum = 0;
+        for (const auto& c : this->components) {
+            sum += c.second;
+        }
+        return sum;
+    }
+
+    // 0, if the component does not exist.
+    size_t operator[](const std::string& component) const {
+        for (const auto& [name, bytes] : this->components) {
+            if (name == component)
+                return bytes;
+        }
+        return 0;
+    }
+};
+
+namespace details {
+
+template <typename Vector>
+size_t vector_bytes(const Vector& v) {
+    return v.capacity() * sizeof(typename Vector::value_type);
+}
+
+// ankerl::unordered_dense maps store their values contiguously plus one 8 byte bucket per slot.
+template <typename Map>
+size_t dense_map_bytes(const Map& m) {
+    return m.size() * sizeof(typename Map::value_type) + m.bucket_count() * sizeof(std::uint64_t);
+}
+
+// std::unordered_map allocates one node per element (value and next pointer, cached hash) and a bucket pointer per slot.
+template <typename Map>
+size_t node_map_bytes(const Map& m) {
+    return m.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*)) + m.bucket_count() * sizeof(void*);
+}
+
+}
+}
+#endif
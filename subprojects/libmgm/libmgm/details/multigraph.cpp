@@ -1,63 +1,234 @@
 #include "multigraph.hpp"
 
 #include <algorithm>
+#include <numeric>
+#include <unordered_set>
 #include <utility>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
 
 namespace mgm {
+
+namespace details {
+// Counting sort of the assignments by one of their nodes. Keeps the order of assignment_list within a row.
+Adjacency build_adjacency(const std::pmr::vector<AssignmentIdx>& assignment_list, int no_rows, bool by_label, std::pmr::memory_resource* resource) {
+    Adjacency adjacency(resource);
+    adjacency.offsets.assign(no_rows + 1, 0);
+    for (const auto& a : assignment_list) {
+        adjacency.offsets[(by_label ? a.second : a.first) + 1]++;
+    }
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+    adjacency.entries.resize(assignment_list.size());
+    std::vector<int> row_end(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (const auto& a : assignment_list) {
+        int row     = by_label ? a.second : a.first;
+        int entry   = by_label ? a.first : a.second;
+        adjacency.entries[row_end[row]++] = entry;
+    }
+    return adjacency;
+}
+}
     
 Graph::Graph(int id, int no_nodes) : id(id), no_nodes(no_nodes) {};
 
- //TODO: Think about removing this. Code will throw an exception if more assignments/edges are added then buffered here.
 GmModel::GmModel(Graph g1, Graph g2)
     : 
-GmModel::GmModel(g1, g2, 100, 1000) {}
+GmModel::GmModel(g1, g2, 0, 0) {}
 
 GmModel::GmModel(Graph g1, Graph g2, int no_assignments, int no_edges) 
     : 
+GmModel::GmModel(g1, g2, no_assignments, no_edges, nullptr) {}
+
+GmModel::GmModel(Graph g1, Graph g2, int no_assignments, int no_edges, std::shared_ptr<ModelArena> arena) 
+    : 
+    arena(arena),
     graph1(g1), 
-    graph2(g2)
+    graph2(g2),
+    assignment_list(arena ? arena.get() : std::pmr::get_default_resource()),
+    left_adjacency(assignment_list.get_allocator().resource()),
+    right_adjacency(assignment_list.get_allocator().resource())
     {
-    this->costs = std::make_unique<CostMap>(no_assignments, no_edges);
+    this->costs = std::make_unique<CostMap>(no_assignments, no_edges, this->assignment_list.get_allocator().resource());
+    this->costs->owned_by_model = true;
     this->assignment_list.reserve(no_assignments);
-
-    //FIXME: Number of elements for assignments_left and assignments_right is unclear.
-    // Loading assignments without reserving space leads to (avoidable?) reallocations. 
-    this->assignments_left  = std::vector<std::vector<int>>(g1.no_nodes);
-    this->assignments_right = std::vector<std::vector<int>>(g2.no_nodes);
 }
 
-int GmModel::no_assignments()
+int GmModel::no_assignments() const
 {
-    return this->costs->all_assignments().size();
+    return this->costs->no_assignments();
 }
 
-int GmModel::no_edges()
+int GmModel::no_edges() const
 {
-    return this->costs->all_edges().size();
+    return this->costs->no_edges();
 }
 
 void GmModel::add_assignment(int node1, int node2, double cost)
 {
-    // TODO: It should be checked, that node1/node2 is in range of nodes of graphs.
+    if (node1 < 0 || node1 >= this->graph1.no_nodes || node2 < 0 || node2 >= this->graph2.no_nodes) {
+        throw std::out_of_range("Can't add assignment. Node out of range of graph.");
+    }
+    // Assignment ids are positions in assignment_list. A duplicate would leave the list and the cost map out of sync.
+    if (this->costs->contains(node1, node2)) {
+        throw std::invalid_argument("Can't add assignment. Assignment already exists.");
+    }
+    this->thaw();
     (void) this->assignment_list.emplace_back(node1, node2);
 
-    this->costs->set_unary(node1, node2, cost);
-    this->assignments_left[node1].push_back(node2);
-    this->assignments_right[node2].push_back(node1);
+    this->costs->add_unary(node1, node2, cost);
 }
 
 void GmModel::add_edge(int assignment1, int assignment2, double cost) {
-    auto& a1 = this->assignment_list[assignment1];
-    auto& a2 = this->assignment_list[assignment2];
-
-    this->add_edge(a1.first, a1.second, a2.first, a2.second, cost);
+    this->thaw();
+    this->costs->set_pairwise(assignment1, assignment2, cost);
 }
 
 void GmModel::add_edge(int assignment1_node1, int assignment1_node2, int assignment2_node1, int assignment2_node2, double cost) {
+    this->thaw();
     this->costs->set_pairwise(assignment1_node1, assignment1_node2, assignment2_node1, assignment2_node2, cost);
     //this->costs->set_pairwise(a2.first, a2.second, a1.first, a1.second, cost); //FIXME: RAM overhead. Avoids sorting later though.
 }
 
+void GmModel::freeze() const {
+    std::call_once(*this->freeze_flag, [this]() { 
+        this->costs->freeze(this->graph1.no_nodes, this->graph2.no_nodes); 
+        this->build_adjacency();
+    });
+}
+
+void GmModel::assign_frozen(std::pmr::vector<AssignmentIdx> assignments, std::pmr::vector<CostValue> unaries, EdgeCSR edges) {
+    this->costs->assign_frozen(assignments, std::move(unaries), std::move(edges), this->graph1.no_nodes, this->graph2.no_nodes);
+    this->assignment_list = std::move(assignments);
+
+    this->freeze_flag = std::make_unique<std::once_flag>();
+    this->incidence_flag = std::make_unique<std::once_flag>();
+    std::call_once(*this->freeze_flag, [this]() { 
+        this->build_adjacency();
+    });
+}
+
+void GmModel::build_adjacency() const {
+    auto* resource = this->assignment_list.get_allocator().resource();
+    this->left_adjacency  = details::build_adjacency(this->assignment_list, this->graph1.no_nodes, false, resource);
+    this->right_adjacency = details::build_adjacency(this->assignment_list, this->graph2.no_nodes, true, resource);
+}
+
+const Adjacency& GmModel::assignments_left() const {
+    this->freeze();
+    return this->left_adjacency;
+}
+
+const Adjacency& GmModel::assignments_right() const {
+    this->freeze();
+    return this->right_adjacency;
+}
+
+const EdgeCSR& GmModel::edges() const {
+    this->freeze();
+    return this->costs->frozen_edges();
+}
+
+const EdgeCSR& GmModel::incidence() const {
+    this->freeze();
+    std::call_once(*this->incidence_flag, [this]() {
+        this->costs->build_incidence();
+    });
+    return this->costs->incidence();
+}
+
+MemoryUsage GmModel::memory_usage() const {
+    MemoryUsage usage;
+    usage.add("assignment_list", details::vector_bytes(this->assignment_list));
+    usage.add("costs", this->costs->memory_usage());
+
+    size_t adjacency = 0;
+    for (const Adjacency* adj : {&this->left_adjacency, &this->right_adjacency}) {
+        adjacency += details::vector_bytes(adj->offsets) + details::vector_bytes(adj->entries);
+    }
+    usage.add("adjacency", adjacency);
+    return usage;
+}
+
+void GmModel::thaw() {
+    if (!this->costs->is_frozen())
+        return;
+
+    this->costs->thaw();
+    this->left_adjacency  = Adjacency(this->assignment_list.get_allocator().resource());
+    this->right_adjacency = Adjacency(this->assignment_list.get_allocator().resource());
+    this->freeze_flag = std::make_unique<std::once_flag>();
+    this->incidence_flag = std::make_unique<std::once_flag>();
+}
+
+GmModelBuilder::GmModelBuilder(Graph g1, Graph g2) : graph1(g1), graph2(g2) {}
+
+void GmModelBuilder::set_assignments(std::vector<int> nodes1, std::vector<int> nodes2, std::vector<double> costs) {
+    if (nodes1.size() != nodes2.size() || nodes1.size() != costs.size()) {
+        throw std::invalid_argument("Can't set assignments. Arrays differ in length.");
+    }
+    this->nodes1        = std::move(nodes1);
+    this->nodes2        = std::move(nodes2);
+    this->unary_costs   = std::move(costs);
+}
+
+void GmModelBuilder::set_edges(std::vector<int> assignments1, std::vector<int> assignments2, std::vector<double> costs) {
+    if (assignments1.size() != assignments2.size() || assignments1.size() != costs.size()) {
+        throw std::invalid_argument("Can't set edges. Arrays differ in length.");
+    }
+    this->edge_assignments1 = std::move(assignments1);
+    this->edge_assignments2 = std::move(assignments2);
+    this->pairwise_costs    = std::move(costs);
+}
+
+std::shared_ptr<GmModel> GmModelBuilder::build() const {
+    int no_assignments  = static_cast<int>(this->nodes1.size());
+    int no_edges        = static_cast<int>(this->edge_assignments1.size());
+
+    // No hash maps are reserved. Buffers are filled directly and handed to the model frozen.
+    auto model = std::make_shared<GmModel>(this->graph1, this->graph2);
+    auto* resource = model->assignment_list.get_allocator().resource();
+
+    std::pmr::vector<AssignmentIdx> assignments(resource);
+    std::pmr::vector<CostValue> unaries(resource);
+    assignments.reserve(no_assignments);
+    unaries.reserve(no_assignments);
+    for (int i = 0; i < no_assignments; i++) {
+        assignments.emplace_back(this->nodes1[i], this->nodes2[i]);
+        unaries.push_back(static_cast<CostValue>(this->unary_costs[i]));
+    }
+
+    // First pass: Count row sizes. The row of an edge is its smaller assignment id.
+    EdgeCSR csr(resource);
+    csr.offsets.assign(no_assignments + 1, 0);
+    for (int i = 0; i < no_edges; i++) {
+        int a1 = this->edge_assignments1[i];
+        int a2 = this->edge_assignments2[i];
+        if (a1 < 0 || a1 >= no_assignments || a2 < 0 || a2 >= no_assignments) {
+            throw std::out_of_range("Can't add edge. Assignment id out of range.");
+        }
+        csr.offsets[std::min(a1, a2) + 1]++;
+    }
+    std::partial_sum(csr.offsets.begin(), csr.offsets.end(), csr.offsets.begin());
+
+    // Second pass: Fill rows.
+    csr.neighbours.resize(no_edges);
+    csr.costs.resize(no_edges);
+    std::vector<int> row_end(csr.offsets.begin(), csr.offsets.end() - 1);
+    for (int i = 0; i < no_edges; i++) {
+        auto [a1, a2] = CostMap::edge_key(this->edge_assignments1[i], this->edge_assignments2[i]);
+        int pos = row_end[a1]++;
+        csr.neighbours[pos] = a2;
+        csr.costs[pos]      = static_cast<CostValue>(this->pairwise_costs[i]);
+    }
+    csr.sort_rows();
+
+    // Validates node ranges, duplicate assignments and duplicate edges.
+    model->assign_frozen(std::move(assignments), std::move(unaries), std::move(csr));
+
+    return model;
+}
 
 MgmModel::MgmModel(){ 
     //models.reserve(300);
@@ -70,19 +241,253 @@ std::shared_ptr<MgmModel> MgmModel::create_submodel(std::vector<int> graph_ids)
     submodel->graphs.reserve(submodel->no_graphs);
 
     std::sort(graph_ids.begin(), graph_ids.end());
+    std::vector<bool> is_included(this->no_graphs, false);
     for (const auto & id : graph_ids) {
         if (id < 0 || id >= this->no_graphs) {
             throw std::out_of_range("Can't create submodel. Graph ID out of range");
         }
         submodel->graphs.push_back(this->graphs[id]);
+        is_included[id] = true;
     }
-    for (const auto & [key, gm_model] : this->models) {
-        if (std::find(graph_ids.begin(), graph_ids.end(), key.first) != graph_ids.end() &&
-            std::find(graph_ids.begin(), graph_ids.end(), key.second) != graph_ids.end()) {
-            submodel->models[key] = gm_model;
+    // Loads all included pairs of lazy models.
+    for (const auto & key : this->model_keys()) {
+        if (is_included[key.first] && is_included[key.second]) {
+            submodel->add_model(this->gm_model(key.first, key.second));
         }
     }
 
     return submodel;
 }
-}
\ No newline at end of file
+
+void MgmModel::add_model(std::shared_ptr<GmModel> gm_model) {
+    if (this->lazy) {
+        throw std::logic_error("Can't add models to a lazily loaded model.");
+    }
+    int g1 = gm_model->graph1.id;
+    int g2 = gm_model->graph2.id;
+    if (g1 < 0 || g1 >= g2) {
+        throw std::invalid_argument("Can't add model. Graph ids need to be ordered and non-negative.");
+    }
+
+    size_t idx = details::pair_index(g1, g2);
+    if (idx >= this->model_index.size()) {
+        this->model_index.resize(details::pair_index(0, g2 + 1));
+    }
+    this->model_index[idx] = gm_model;
+    this->models[GmModelIdx(g1, g2)] = std::move(gm_model);
+}
+
+void MgmModel::build_model_index() {
+    this->model_index.clear();
+    for (const auto& [key, gm_model] : this->models) {
+        if (key.first < 0 || key.first >= key.second) {
+            throw std::invalid_argument("Can't index models. Graph ids need to be ordered and non-negative.");
+        }
+        size_t idx = details::pair_index(key.first, key.second);
+        if (idx >= this->model_index.size()) {
+            this->model_index.resize(details::pair_index(0, key.second + 1));
+        }
+        this->model_index[idx] = gm_model;
+    }
+}
+
+std::vector<GmModelIdx> MgmModel::model_keys() const {
+    if (this->lazy)
+        return this->lazy->keys;
+
+    std::vector<GmModelIdx> keys;
+    keys.reserve(this->models.size());
+    for (const auto& [key, gm_model] : this->models) {
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+void MgmModel::set_loader(std::shared_ptr<ModelLoader> loader, std::vector<GmModelIdx> keys, size_t memory_budget) {
+    auto lazy = std::make_shared<LazyModels>();
+    lazy->loader = std::move(loader);
+    lazy->memory_budget = memory_budget;
+
+    for (const auto& [g1, g2] : keys) {
+        if (g1 < 0 || g1 >= g2) {
+            throw std::invalid_argument("Can't index models. Graph ids need to be ordered and non-negative.");
+        }
+        size_t idx = details::pair_index(g1, g2);
+        if (idx >= lazy->available.size()) {
+            lazy->available.resize(details::pair_index(0, g2 + 1));
+        }
+        lazy->available[idx] = true;
+    }
+    lazy->keys = std::move(keys);
+
+    this->models.clear();
+    this->model_index.clear();
+    this->lazy = std::move(lazy);
+}
+
+std::shared_ptr<GmModel> MgmModel::load_model(int g1, int g2) const {
+    if (!this->has_model(g1, g2))
+        return nullptr;
+
+    return this->lazy->load(g1, g2);
+}
+
+std::shared_ptr<GmModel> MgmModel::LazyModels::load(int g1, int g2) {
+    if (this->parent) {
+        // Graph ids of a view are sorted, so the pair stays ordered in the parent.
+        return this->parent->load(this->parent_ids[g1], this->parent_ids[g2]);
+    }
+    GmModelIdx key(g1, g2);
+
+    // Concurrent requests for a model being loaded wait for the first one, so every model is loaded once.
+    // The lock only guards the bookkeeping. Different models are loaded in parallel.
+    std::promise<std::shared_ptr<GmModel>> promise;
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        auto it = this->resident.find(key);
+        if (it != this->resident.end()) {
+            this->lru.splice(this->lru.begin(), this->lru, it->second.lru_position);
+            return it->second.model;
+        }
+
+        auto loading_it = this->loading.find(key);
+        if (loading_it != this->loading.end()) {
+            auto pending = loading_it->second;
+            lock.unlock();
+            return pending.get();
+        }
+        this->loading.emplace(key, promise.get_future().share());
+    }
+
+    std::shared_ptr<GmModel> gm_model;
+    try {
+        gm_model = this->loader->load(g1, g2);
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->loading.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    size_t bytes = gm_model->memory_usage().total();
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->loading.erase(key);
+
+        this->lru.push_front(key);
+        this->resident.emplace(key, Entry{gm_model, this->lru.begin(), bytes});
+        this->resident_bytes += bytes;
+
+        // Evict the least recently used models. Models still referenced elsewhere stay alive until released.
+        while (this->memory_budget > 0 && this->resident_bytes > this->memory_budget && this->lru.size() > 1) {
+            auto evicted = this->resident.find(this->lru.back());
+            spdlog::debug("Evicting model ({} {}) from memory.", evicted->first.first, evicted->first.second);
+
+            this->resident_bytes -= evicted->second.bytes;
+            this->resident.erase(evicted);
+            this->lru.pop_back();
+        }
+    }
+    promise.set_value(gm_model);
+    return gm_model;
+}
+
+MgmModelView::MgmModelView(const MgmModel& parent, std::vector<int> graph_ids) {
+    std::sort(graph_ids.begin(), graph_ids.end());
+    graph_ids.erase(std::unique(graph_ids.begin(), graph_ids.end()), graph_ids.end());
+
+    // Views of views refer to the root model.
+    const auto* parent_view = dynamic_cast<const MgmModelView*>(&parent);
+
+    this->no_graphs = graph_ids.size();
+    this->graphs.reserve(this->no_graphs);
+    this->global_ids.reserve(this->no_graphs);
+    for (int local = 0; local < this->no_graphs; local++) {
+        int parent_id = graph_ids[local];
+        if (parent_id < 0 || parent_id >= parent.no_graphs) {
+            throw std::out_of_range("Can't create view. Graph ID out of range");
+        }
+        this->graphs.emplace_back(local, parent.graphs[parent_id].no_nodes);
+        this->global_ids.push_back(parent_view ? parent_view->global_id(parent_id) : parent_id);
+    }
+
+    this->local_ids.assign(this->global_ids.empty() ? 0 : this->global_ids.back() + 1, -1);
+    for (int local = 0; local < this->no_graphs; local++) {
+        this->local_ids[this->global_ids[local]] = local;
+    }
+
+    // Lazy parents: Only the available pairs are indexed. Models are looked up in the parent on access.
+    if (parent.lazy) {
+        auto lazy = std::make_shared<LazyModels>();
+        lazy->parent        = parent.lazy;
+        lazy->parent_ids    = graph_ids;
+        lazy->available.resize(details::pair_index(0, this->no_graphs));
+        for (int l2 = 1; l2 < this->no_graphs; l2++) {
+            for (int l1 = 0; l1 < l2; l1++) {
+                if (!parent.has_model(graph_ids[l1], graph_ids[l2]))
+                    continue;
+                lazy->available[details::pair_index(l1, l2)] = true;
+                lazy->keys.emplace_back(l1, l2);
+            }
+        }
+        this->lazy = std::move(lazy);
+        return;
+    }
+
+    // Graph ids are sorted, so the pair order of the parent is kept.
+    this->models.reserve((size_t) this->no_graphs * (this->no_graphs - 1) / 2);
+    for (int l2 = 1; l2 < this->no_graphs; l2++) {
+        for (int l1 = 0; l1 < l2; l1++) {
+            if (!parent.has_model(graph_ids[l1], graph_ids[l2]))
+                continue;
+            this->models[GmModelIdx(l1, l2)] = parent.gm_model(graph_ids[l1], graph_ids[l2]);
+        }
+    }
+    this->build_model_index();
+}
+
+MemoryUsage MgmModel::memory_usage() const {
+    std::unordered_set<const ModelArena*> arenas;
+    auto add_model_usage = [&arenas](MemoryUsage& usage, const GmModel& gm_model) {
+        for (const auto& [name, bytes] : gm_model.memory_usage().components) {
+            usage.add(name, bytes);
+        }
+        if (gm_model.model_arena()) {
+            arenas.insert(gm_model.model_arena().get());
+        }
+    };
+
+    MemoryUsage usage;
+    for (const auto& [key, gm_model] : this->models) {
+        add_model_usage(usage, *gm_model);
+    }
+    usage.add("models", details::node_map_bytes(this->models) + details::vector_bytes(this->model_index));
+
+    if (this->lazy) {
+        std::lock_guard<std::mutex> lock(this->lazy->mutex);
+        for (const auto& [key, entry] : this->lazy->resident) {
+            add_model_usage(usage, *entry.model);
+        }
+        usage.add("lazy_index", details::vector_bytes(this->lazy->keys) + this->lazy->available.capacity() / 8 
+                                + details::node_map_bytes(this->lazy->resident) + this->lazy->lru.size() * (sizeof(GmModelIdx) + 2 * sizeof(void*)));
+    }
+    usage.add("graphs", details::vector_bytes(this->graphs));
+
+    size_t arena_unused = 0;
+    for (const auto* arena : arenas) {
+        arena_unused += arena->reserved_bytes() - arena->allocated_bytes();
+    }
+    usage.add("arena_unused", arena_unused);
+    return usage;
+}
+
+int MgmModelView::local_id(int global_id) const {
+    if (global_id < 0 || global_id >= static_cast<int>(this->local_ids.size())) {
+        return -1;
+    }
+    return this->local_ids[global_id];
+}
+}
@@ -1,12 +1,18 @@
 #ifndef LIBMGM_MULTIGRAPH_HPP
 #define LIBMGM_MULTIGRAPH_HPP
 
+#include <cassert>
+#include <future>
+#include <list>
 #include <unordered_map>
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <utility>
 
+#include "arena.hpp"
 #include "costs.hpp"
 
 
@@ -23,6 +29,15 @@ struct GmModelIdxHash {
     }
 };
 
+namespace details {
+// Position of graph pair (g1, g2), g1 < g2, in a packed upper triangular pair table, stored column by column:
+// (0,1), (0,2), (1,2), (0,3), ... Independent of the number of graphs, so a table of n graphs has pair_index(0, n) entries
+// and only grows at the end when graphs are added.
+inline size_t pair_index(int g1, int g2) {
+    return (size_t) g2 * (g2 - 1) / 2 + g1;
+}
+}
+
 class Graph {
     public:
         Graph() {};
@@ -32,15 +47,45 @@ class Graph {
         int no_nodes=-1;
 };
 
+// Flat adjacency lists, e.g. all labels of every node. Row i spans [offsets[i], offsets[i+1]) of entries.
+struct Adjacency {
+    struct Row {
+        const int* first;
+        const int* last;
+
+        const int* begin()  const { return first; }
+        const int* end()    const { return last; }
+        size_t size()       const { return last - first; }
+        bool empty()        const { return first == last; }
+        const int& operator[](size_t i) const { return first[i]; }
+    };
+
+    explicit Adjacency(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : offsets(1, 0, resource), entries(resource) {};
+
+    std::pmr::vector<int> offsets;
+    std::pmr::vector<int> entries;
+
+    size_t size() const { return offsets.size() - 1; }
+    Row operator[](size_t row) const { return Row{entries.data() + offsets[row], entries.data() + offsets[row + 1]}; }
+};
+
 class GmModel{
+    private:
+        // Declared first, so that it outlives all containers allocated from it.
+        std::shared_ptr<ModelArena> arena; // Empty, if allocated on the heap.
+
     public:
         GmModel(Graph g1, Graph g2);
         GmModel(Graph g1, Graph g2, int no_assignments, int no_edges);
+        // All cost and adjacency data is allocated from the arena, which may be shared with other models.
+        // The model keeps the arena alive.
+        GmModel(Graph g1, Graph g2, int no_assignments, int no_edges, std::shared_ptr<ModelArena> arena);
         Graph graph1;
         Graph graph2;
 
-        int no_assignments();
-        int no_edges();
+        int no_assignments() const;
+        int no_edges() const;
 
         void add_assignment(int node1, int node2, double cost);
 
@@ -48,22 +93,195 @@ class GmModel{
         void add_edge(int assignment1, int assigment2, double cost);
         void add_edge(int assignment1_node1, int assignment1_node2, int assignment2_node1, int assignment2_node2, double cost);
 
-        std::vector<AssignmentIdx> assignment_list;
-        std::vector<std::vector<int>> assignments_left;
-        std::vector<std::vector<int>> assignments_right;
+        // Compacts the costs into their read-only layout. Should be called once the model is fully loaded.
+        // Read accessors freeze lazily (and thread safe), if this was skipped. Adding assignments or edges thaws the model.
+        void freeze() const;
+        const EdgeCSR& edges() const;
+
+        // Bulk alternative to add_assignment, add_edge and freeze, e.g. for GmModelBuilder or binary files.
+        // Edges are given in the layout of edges(). The model is frozen afterwards. See CostMap::assign_frozen.
+        void assign_frozen(std::pmr::vector<AssignmentIdx> assignments, std::pmr::vector<CostValue> unaries, EdgeCSR edges);
+
+        // Edges incident to assignment a are the range [offsets[a], offsets[a+1]) of the returned layout.
+        // Built on first use.
+        const EdgeCSR& incidence() const;
+
+        // Labels of every node in graph1 and nodes of every label in graph2, in order of assignment_list.
+        // Computed on freeze.
+        const Adjacency& assignments_left() const;
+        const Adjacency& assignments_right() const;
+
+        // Heap and arena memory held by this model. Does not freeze the model.
+        // Unused space of the arena is reported by MgmModel::memory_usage, as the arena may be shared.
+        MemoryUsage memory_usage() const;
+
+        // Empty, if the model is allocated on the heap.
+        const std::shared_ptr<ModelArena>& model_arena() const { return this->arena; }
+
+        std::pmr::vector<AssignmentIdx> assignment_list;
+        // Costs of existing assignments and edges can be set here directly, also on a frozen model (see CostMap::set_unary).
         std::unique_ptr<CostMap> costs;
+
+    private:
+        mutable Adjacency left_adjacency;
+        mutable Adjacency right_adjacency;
+
+        mutable std::unique_ptr<std::once_flag> freeze_flag = std::make_unique<std::once_flag>();
+        mutable std::unique_ptr<std::once_flag> incidence_flag = std::make_unique<std::once_flag>();
+        void build_adjacency() const;
+        void thaw();
+};
+
+// Bulk construction of a GmModel from flat arrays.
+// All input is validated at once and every buffer of the model is allocated with its exact size.
+// Unlike add_edge, duplicate edges are rejected instead of overwritten.
+class GmModelBuilder {
+    public:
+        GmModelBuilder(Graph g1, Graph g2);
+
+        // Assignment i is (nodes1[i], nodes2[i]) with the given cost. Its assignment id is i.
+        void set_assignments(std::vector<int> nodes1, std::vector<int> nodes2, std::vector<double> costs);
+
+        // Edge i is between the assignment ids assignments1[i] and assignments2[i].
+        void set_edges(std::vector<int> assignments1, std::vector<int> assignments2, std::vector<double> costs);
+
+        std::shared_ptr<GmModel> build() const;
+
+    private:
+        Graph graph1;
+        Graph graph2;
+
+        std::vector<int> nodes1;
+        std::vector<int> nodes2;
+        std::vector<double> unary_costs;
+
+        std::vector<int> edge_assignments1;
+        std::vector<int> edge_assignments2;
+        std::vector<double> pairwise_costs;
+};
+
+// Loads the model of a graph pair on demand, e.g. from an indexed file (see io::open_lazy).
+// Different pairs may be loaded concurrently, so load() needs to be thread safe.
+class ModelLoader {
+    public:
+        virtual ~ModelLoader() = default;
+        virtual std::shared_ptr<GmModel> load(int g1, int g2) = 0;
 };
 
+class MgmModelView;
+
 class MgmModel {
     public:
         MgmModel();
+        virtual ~MgmModel() = default;
 
         std::shared_ptr<MgmModel> create_submodel(std::vector<int> graph_ids);
 
+        // Inserts into models and the pair index. Graph ids of the model need to be ordered (graph1.id < graph2.id).
+        void add_model(std::shared_ptr<GmModel> gm_model);
+
+        // O(1) lookup of the model between graphs g1 < g2. Empty pointer, if no model exists for the pair.
+        // This includes swapped or out of range graph ids. Lazy models are loaded on first access.
+        std::shared_ptr<GmModel> gm_model(int g1, int g2) const {
+            if (!this->has_model(g1, g2))
+                return nullptr;
+            if (this->lazy)
+                return this->load_model(g1, g2);
+            return this->model_index[details::pair_index(g1, g2)];
+        }
+
+        // As gm_model(), but throws std::out_of_range if no model exists for the pair.
+        std::shared_ptr<GmModel> gm_model_at(int g1, int g2) const {
+            if (!this->has_model(g1, g2))
+                throw std::out_of_range("No model for graph pair (" + std::to_string(g1) + ", " + std::to_string(g2) + ").");
+            return this->gm_model(g1, g2);
+        }
+
+        bool has_model(int g1, int g2) const {
+            size_t idx = details::pair_index(g1, g2);
+            if (this->lazy)
+                return 0 <= g1 && g1 < g2 && idx < this->lazy->available.size() && this->lazy->available[idx];
+            return 0 <= g1 && g1 < g2 && idx < this->model_index.size() && this->model_index[idx];
+        }
+
+        // Needs to be called after modifying models directly.
+        void build_model_index();
+
+        // Keys of all graph pairs, including those of lazy models that are not loaded.
+        std::vector<GmModelIdx> model_keys() const;
+
+        // Models of the given graph pairs are loaded by `loader` on first access.
+        // If `memory_budget` (in bytes) is non-zero, the least recently used models are dropped to stay within the budget.
+        // Lazy models are not stored in `models`. Use model_keys() and gm_model() to access them.
+        void set_loader(std::shared_ptr<ModelLoader> loader, std::vector<GmModelIdx> keys, size_t memory_budget=0);
+        bool is_lazy() const { return this->lazy != nullptr; }
+
+        // Summed over all GmModels, including those shared with other (sub)models.
+        // For lazy models, only the models in memory are counted.
+        // Unused space of the arenas of the models is reported once per arena as "arena_unused".
+        MemoryUsage memory_usage() const;
+
         int no_graphs = 0;
         std::vector<Graph> graphs;
-        
+
         std::unordered_map<GmModelIdx, std::shared_ptr<GmModel>, GmModelIdxHash> models;
+
+    private:
+        // Views share the lazy models of their parent.
+        friend class MgmModelView;
+
+        // Models by details::pair_index(g1, g2).
+        std::vector<std::shared_ptr<GmModel>> model_index;
+
+        // Models in memory, ordered by last access. Shared between copies of the model.
+        struct LazyModels {
+            struct Entry {
+                std::shared_ptr<GmModel> model;
+                std::list<GmModelIdx>::iterator lru_position;
+                size_t bytes;
+            };
+
+            // Loads or looks up the model of an available pair. The lock is not held while loading.
+            std::shared_ptr<GmModel> load(int g1, int g2);
+
+            std::shared_ptr<ModelLoader> loader;
+            std::vector<GmModelIdx> keys;
+            std::vector<bool> available; // By pair index
+            size_t memory_budget = 0;
+
+            // Views forward to the models of their parent and keep none themselves.
+            std::shared_ptr<LazyModels> parent;
+            std::vector<int> parent_ids; // Local graph id -> graph id in the parent
+
+            std::mutex mutex;
+            std::unordered_map<GmModelIdx, Entry, GmModelIdxHash> resident;
+            std::unordered_map<GmModelIdx, std::shared_future<std::shared_ptr<GmModel>>, GmModelIdxHash> loading;
+            std::list<GmModelIdx> lru; // Most recently used first
+            size_t resident_bytes = 0;
+        };
+        std::shared_ptr<LazyModels> lazy;
+
+        std::shared_ptr<GmModel> load_model(int g1, int g2) const;
+};
+
+// Submodel over a subset of graphs, which shares the GmModel objects of its parent.
+// Graphs are renumbered to 0..no_graphs-1 (in ascending order of their parent ids), so that all solvers can run on a view.
+// GmModel objects keep the graph ids of the parent.
+// Views of lazy models load nothing up front. Lookups go through the loader and memory budget of the parent.
+class MgmModelView : public MgmModel {
+    public:
+        MgmModelView(const MgmModel& parent, std::vector<int> graph_ids);
+
+        // Ids in the root model, if the parent is a view itself.
+        int global_id(int local_id) const { return this->global_ids[local_id]; }
+        // -1, if the graph is not part of the view.
+        int local_id(int global_id) const;
+
+        const std::vector<int>& graph_ids() const { return this->global_ids; }
+
+    private:
+        std::vector<int> global_ids;
+        std::vector<int> local_ids;
 };
 
 }
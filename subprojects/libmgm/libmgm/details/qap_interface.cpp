@@ -52,7 +52,7 @@ void QAPSolver::construct_solver() {
     // Insert unary factors
     for (int qap_node = 0; qap_node < deco.no_qap_nodes; qap_node++) {
         int gm_node = deco.gm_id(qap_node);
-        auto& gm_node_assignments = m->assignments_left[gm_node];
+        auto gm_node_assignments = m->assignments_left()[gm_node];
 
         int no_b = this->decomposition.no_backward[gm_node];
         int no_f = this->decomposition.no_forward[gm_node];
@@ -68,8 +68,8 @@ void QAPSolver::construct_solver() {
     }
 
     // Insert uniqueness factors
-    for (size_t gm_label = 0; gm_label < m->assignments_right.size(); gm_label++) {
-        auto& gm_label_assignments = m->assignments_right[gm_label];
+    for (size_t gm_label = 0; gm_label < m->assignments_right().size(); gm_label++) {
+        auto gm_label_assignments = m->assignments_right()[gm_label];
 
         int no_assignments = gm_label_assignments.size();
 
@@ -83,7 +83,7 @@ void QAPSolver::construct_solver() {
             // Assume also 20 associated assignments for gm_node in assignments_left.
             //
             // Here we need to find for the given gm_node, which position the original gm_label has, to link the uniqueness constraint correctly.
-            auto& gm_node_assignments = m->assignments_left[gm_node];
+            auto gm_node_assignments = m->assignments_left()[gm_node];
             auto gm_label_it = std::find(gm_node_assignments.begin(), gm_node_assignments.end(), gm_label); // FIXME: O(n) is best avoided.
             int gm_label_idx = std::distance(gm_node_assignments.begin(), gm_label_it);
 
@@ -102,8 +102,8 @@ void QAPSolver::construct_solver() {
             int qap_node2 = deco.qap_id(gm_node2);
             mpopt_qap_graph_add_pairwise_link(g, qap_node1, qap_node2, pairwise_idx);
             
-            assert(costs.size() == m->assignments_left[gm_node1].size() + 1);
-            assert(costs[0].size() == m->assignments_left[gm_node2].size() + 1);
+            assert(costs.size() == m->assignments_left()[gm_node1].size() + 1);
+            assert(costs[0].size() == m->assignments_left()[gm_node2].size() + 1);
 
             for (size_t c_i = 0; c_i < costs.size(); c_i++) {
                 for (size_t c_j = 0; c_j < costs[0].size(); c_j++) {
@@ -138,19 +138,19 @@ GmSolution QAPSolver::extract_solution() {
         unsigned long lib_primal = mpopt_qap_unary_get_primal(mpopt_qap_graph_get_unary(g, qap_node));
         int gm_node = this->decomposition.gm_id(qap_node);
 
-        if (lib_primal < this->model->assignments_left[gm_node].size()) {
-            int label = this->model->assignments_left[gm_node][lib_primal];
+        if (lib_primal < this->model->assignments_left()[gm_node].size()) {
+            int label = this->model->assignments_left()[gm_node][lib_primal];
             solution[gm_node] = label;
         }
         else {
             // Assert dummy node assignment, not out of range.
-            assert (lib_primal == this->model->assignments_left[gm_node].size());
+            assert (lib_primal == this->model->assignments_left()[gm_node].size());
         }
     }
     return solution;
 }
 
-size_t QAPSolver::estimate_memory_kib()
+size_t QAPSolver::estimate_memory_kib() const
 {
     auto m = this->model;
     auto& deco = this->decomposition;
@@ -160,20 +160,16 @@ size_t QAPSolver::estimate_memory_kib()
     size_t  pairwise_inserts    = 0;
 
     // Count for unary factors
-    for (const auto& v : m->assignments_left) {
-        unary_inserts += v.size();
-    }
+    unary_inserts += m->assignment_list.size();
     unary_inserts *= 2; // no_connections for unaries is added twice in libmpopt.
 
     unary_inserts += std::reduce(deco.no_backward.begin(),  deco.no_backward.end());
     unary_inserts += std::reduce(deco.no_forward.begin(),   deco.no_forward.end());
 
     // Count for uniqueness factors
-    for (const auto& v : m->assignments_right) {
-        uniqueness_inserts += v.size();
-    }
+    uniqueness_inserts += m->assignment_list.size();
     uniqueness_inserts *= 2;
-    uniqueness_inserts += m->assignments_right.size(); // +1 on every factor for dummy nodes.
+    uniqueness_inserts += m->assignments_right().size(); // +1 on every factor for dummy nodes.
 
     // Count pairwise factors
     for (auto& [gm_node1, node1_pairwise]: deco.pairwise) {
@@ -198,6 +194,13 @@ size_t QAPSolver::estimate_memory_kib()
     return estimate * 2;
 }
 
+MemoryUsage QAPSolver::memory_usage() const {
+    MemoryUsage usage;
+    usage.add("decomposition", this->decomposition.memory_usage());
+    usage.add("mpopt_estimate", this->estimate_memory_kib() * 1024);
+    return usage;
+}
+
 namespace details
 {
 
@@ -207,8 +210,8 @@ ModelDecomposition::ModelDecomposition(const GmModel& model) {
     // Remap indices. Unneccessary in most cases, but there sadly are some edge cases.
     this->qap_node_id_to_model_node_id.reserve(model.graph1.no_nodes);
     this->model_node_id_to_qap_node_id.reserve(model.graph1.no_nodes);
-    for (size_t i = 0; i < model.assignments_left.size(); i++) {
-        if (!model.assignments_left[i].empty()) {
+    for (size_t i = 0; i < model.assignments_left().size(); i++) {
+        if (!model.assignments_left()[i].empty()) {
             model_node_id_to_qap_node_id[i] = qap_node_id_to_model_node_id.size();
             qap_node_id_to_model_node_id.push_back(i);
         }
@@ -220,13 +223,17 @@ ModelDecomposition::ModelDecomposition(const GmModel& model) {
 
     // add pairwise edges
     this->pairwise.reserve(model.graph1.no_nodes);
-    for (const auto& edge : model.costs->all_edges()) {
-        insert_pairwise(model, edge.first, edge.second);
+    const auto& edges = model.edges();
+    for (int a1 = 0; a1 < edges.no_rows(); a1++) {
+        for (int i = edges.offsets[a1]; i < edges.offsets[a1+1]; i++) {
+            EdgeIdx e(model.assignment_list[a1], model.assignment_list[edges.neighbours[i]]);
+            insert_pairwise(model, e, edges.costs[i]);
+        }
     }
 
     // Set pairwise edge cost to infinity for prohibiting assignment constraints.
-    for (size_t label = 0; label < model.assignments_right.size(); label++) {
-        auto label_ass = model.assignments_right[label];
+    for (size_t label = 0; label < model.assignments_right().size(); label++) {
+        auto label_ass = model.assignments_right()[label];
         if (label_ass.size() < 2) {
             continue;
         }
@@ -264,8 +271,8 @@ void ModelDecomposition::insert_pairwise(const GmModel& model, const EdgeIdx& ed
         
         // cost structure. +1 for dummy nodes.
         std::pair<int, int> shape;
-        shape.first = model.assignments_left[a1.first].size() + 1;
-        shape.second = model.assignments_left[a2.first].size() + 1;
+        shape.first = model.assignments_left()[a1.first].size() + 1;
+        shape.second = model.assignments_left()[a2.first].size() + 1;
 
         // Cost matrix between two assignments
         auto cost_structure = DecompCosts(shape.first, std::vector<double>(shape.second, 0.0));
@@ -277,10 +284,10 @@ void ModelDecomposition::insert_pairwise(const GmModel& model, const EdgeIdx& ed
         return;
     }
 
-    auto a1_ass = model.assignments_left[a1.first];
+    auto a1_ass = model.assignments_left()[a1.first];
     int pos1 = std::distance(a1_ass.begin(), std::find(a1_ass.begin(), a1_ass.end(), a1.second));
 
-    auto a2_ass = model.assignments_left[a2.first];
+    auto a2_ass = model.assignments_left()[a2.first];
     int pos2 = std::distance(a2_ass.begin(), std::find(a2_ass.begin(), a2_ass.end(), a2.second));
     
     assert(pairwise_costs->second[pos1][pos2] == 0.0 || pairwise_costs->second[pos1][pos2] == cost);
@@ -294,5 +301,24 @@ int ModelDecomposition::gm_id(int qap_node_id) {
 int ModelDecomposition::qap_id(int gm_node_id) {
     return this->model_node_id_to_qap_node_id[gm_node_id];
 }
+
+MemoryUsage ModelDecomposition::memory_usage() const {
+    size_t pairwise_bytes = node_map_bytes(this->pairwise);
+    for (const auto& [node1, node1_pairwise] : this->pairwise) {
+        pairwise_bytes += node_map_bytes(node1_pairwise);
+        for (const auto& [node2, costs] : node1_pairwise) {
+            pairwise_bytes += vector_bytes(costs);
+            for (const auto& row : costs) {
+                pairwise_bytes += vector_bytes(row);
+            }
+        }
+    }
+
+    MemoryUsage usage;
+    usage.add("pairwise", pairwise_bytes);
+    usage.add("node_ids", vector_bytes(this->no_forward) + vector_bytes(this->no_backward)
+                        + vector_bytes(this->qap_node_id_to_model_node_id) + node_map_bytes(this->model_node_id_to_qap_node_id));
+    return usage;
+}
 }
 }
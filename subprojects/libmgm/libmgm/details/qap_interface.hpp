@@ -6,6 +6,7 @@
 
 #include <mpopt/qap.h>
 
+#include "memory_usage.hpp"
 #include "multigraph.hpp"
 #include "solution.hpp"
 
@@ -28,6 +29,8 @@ class ModelDecomposition {
         int gm_id(int qap_node_id);
         int qap_id(int gm_node_id);
         int no_qap_nodes;
+
+        MemoryUsage memory_usage() const;
     private:
         // Node ID's without any assignments associated with them (yes, may happen),
         // will not be constructed as unaries in the QAP-Solver.
@@ -54,6 +57,9 @@ class QAPSolver {
         };
 
         StoppingCriteria stopping_criteria;
+
+        // The model decomposition and the memory reserved for the libmpopt solver (see estimate_memory_kib).
+        MemoryUsage memory_usage() const;
     private:
 
         // mpopt_qap_solver is defined in qap.h as a forward declaration.
@@ -74,7 +80,7 @@ class QAPSolver {
 
         void construct_solver();
         GmSolution extract_solution();
-        size_t estimate_memory_kib();
+        size_t estimate_memory_kib() const;
 };
 }
 #endif
\ No newline at end of file
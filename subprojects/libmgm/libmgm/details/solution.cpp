@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <map>
+#include <string>
 #include <vector>
 #include <memory>
 #include <utility>
@@ -8,6 +10,8 @@
 #include <cassert>
 #include <numeric>
 
+#include <omp.h>
+
 // Logging
 #include <spdlog/spdlog.h>
 
@@ -20,7 +24,7 @@ namespace mgm {
 
 constexpr double INFINITY_COST = 1e99;
 // Forward declaration
-CliqueTable clique_table_from_labeling(Labeling& labeling, std::vector<Graph>& graphs);
+CliqueTable clique_table_from_labeling(const DenseLabeling& labeling, const std::vector<Graph>& graphs);
 
 GmSolution::GmSolution(std::shared_ptr<GmModel> model) : model(model) {
     this->labeling_ = std::vector<int>(model->graph1.no_nodes, -1);
@@ -34,11 +38,56 @@ bool GmSolution::is_active(const AssignmentIdx& assignment, const std::vector<in
     return labeling[assignment.first] == assignment.second;
 }
 
+bool GmSolution::is_active(const AssignmentIdx& assignment, const int* labeling)
+{
+    return labeling[assignment.first] == assignment.second;
+}
+
 bool GmSolution::is_active(AssignmentIdx assignment) const {
     return GmSolution::is_active(assignment, this->labeling_);
 }
 
+// Walks the rows of the active assignments only. 
+// Every edge is stored in the row of its smaller assignment id (see EdgeCSR), so each active edge is summed once.
 double GmSolution::evaluate(const GmModel &model, const std::vector<int> &labeling)
+{
+    return GmSolution::evaluate(model, labeling.data(), (int) labeling.size());
+}
+
+double GmSolution::evaluate(const GmModel &model, const int* labeling)
+{
+    return GmSolution::evaluate(model, labeling, model.graph1.no_nodes);
+}
+
+double GmSolution::evaluate(const GmModel &model, const int* labeling, int size)
+{
+    double result = 0.0;
+
+    const auto& assignments = model.assignment_list;
+    const auto& unaries = model.costs->unary_costs();
+    const auto& edges = model.edges();
+
+    for (int node = 0; node < size; node++) {
+        const int label = labeling[node];
+        if (label < 0)
+            continue;
+
+        int a1 = model.costs->assignment_id(node, label);
+        if (a1 < 0)
+            return INFINITY_COST;
+
+        result += unaries[a1];
+        for (int i = edges.offsets[a1]; i < edges.offsets[a1+1]; i++) {
+            if (GmSolution::is_active(assignments[edges.neighbours[i]], labeling)) {
+                result += edges.costs[i];
+            }
+        }
+    }
+
+    return result;
+}
+
+double GmSolution::evaluate_reference(const GmModel &model, const std::vector<int> &labeling)
 {
     double result = 0.0;
 
@@ -46,8 +95,9 @@ double GmSolution::evaluate(const GmModel &model, const std::vector<int> &labeli
     int node = 0;
     for (const auto& label : labeling) {
         if (label >= 0) {
-            if (model.costs->contains(node, label)) {
-                result += model.costs->unary(node, label);
+            int id = model.costs->assignment_id(node, label);
+            if (id >= 0) {
+                result += model.costs->unary_costs()[id];
             }
             else {
                 return INFINITY_COST;
@@ -57,13 +107,12 @@ double GmSolution::evaluate(const GmModel &model, const std::vector<int> &labeli
     }
 
     //edges
-    for (const auto& [edge_idx, cost] : model.costs->all_edges()) {
-        auto& a1 = edge_idx.first;
-        auto& a2 = edge_idx.second;
-        if (GmSolution::is_active(a1, labeling) && GmSolution::is_active(a2, labeling)) {
+    const auto& assignments = model.assignment_list;
+    model.costs->for_each_edge([&](EdgeKey edge_key, CostValue cost) {
+        if (GmSolution::is_active(assignments[edge_key.first], labeling) && GmSolution::is_active(assignments[edge_key.second], labeling)) {
             result += cost;
         }
-    }
+    });
 
     return result;
 }
@@ -89,9 +138,113 @@ std::vector<int>& GmSolution::labeling(){
 }
 
 
+DenseLabeling::DenseLabeling(const std::vector<Graph>& graphs, const std::vector<GmModelIdx>& keys)
+    : no_graphs(graphs.size()) {
+    this->no_nodes.reserve(graphs.size());
+    for (const auto& g : graphs) {
+        this->no_nodes.push_back(g.no_nodes);
+    }
+    this->offsets.assign(details::pair_index(0, this->no_graphs), -1);
+
+    // Mark contained pairs, then assign offsets in upper triangular order.
+    for (const auto& idx : keys) {
+        if (idx.first < 0 || idx.first >= idx.second || idx.second >= this->no_graphs) {
+            throw std::invalid_argument("Invalid graph pair (" + std::to_string(idx.first) + ", " + std::to_string(idx.second) + ") in labeling.");
+        }
+        this->offsets[details::pair_index(idx.first, idx.second)] = 0;
+    }
+    std::int64_t size = 0;
+    for (int g1 = 0; g1 < this->no_graphs; g1++) {
+        for (int g2 = g1 + 1; g2 < this->no_graphs; g2++) {
+            auto& offset = this->offsets[details::pair_index(g1, g2)];
+            if (offset < 0)
+                continue;
+            offset = size;
+            size += this->no_nodes[g1];
+            this->keys_.emplace_back(g1, g2);
+        }
+    }
+    this->labels_.assign(size, -1);
+}
+
+DenseLabeling::DenseLabeling(const std::vector<Graph>& graphs, const Labeling& labeling) {
+    std::vector<GmModelIdx> keys;
+    keys.reserve(labeling.size());
+    for (const auto& [idx, l] : labeling) {
+        keys.push_back(idx);
+    }
+    *this = DenseLabeling(graphs, keys);
+
+    for (const auto& [idx, l] : labeling) {
+        this->assign(idx, l);
+    }
+}
+
+bool DenseLabeling::contains(const GmModelIdx& idx) const {
+    if (idx.first < 0 || idx.first >= idx.second || idx.second >= this->no_graphs)
+        return false;
+    return this->offsets[details::pair_index(idx.first, idx.second)] >= 0;
+}
+
+size_t DenseLabeling::offset(const GmModelIdx& idx) const {
+    if (!this->contains(idx)) {
+        throw std::out_of_range("DenseLabeling does not contain graph pair (" + std::to_string(idx.first) + ", " + std::to_string(idx.second) + ").");
+    }
+    return this->offsets[details::pair_index(idx.first, idx.second)];
+}
+
+int* DenseLabeling::at(const GmModelIdx& idx) {
+    return this->labels_.data() + this->offset(idx);
+}
+
+const int* DenseLabeling::at(const GmModelIdx& idx) const {
+    return this->labels_.data() + this->offset(idx);
+}
+
+std::vector<int> DenseLabeling::to_vector(const GmModelIdx& idx) const {
+    const int* first = this->at(idx);
+    return std::vector<int>(first, first + this->size(idx));
+}
+
+void DenseLabeling::assign(const GmModelIdx& idx, const std::vector<int>& labeling) {
+    int* first = this->at(idx);
+    if ((int) labeling.size() != this->size(idx)) {
+        throw std::invalid_argument("Labeling of graph pair (" + std::to_string(idx.first) + ", " + std::to_string(idx.second) 
+                                    + ") does not match the size of graph " + std::to_string(idx.first) + ".");
+    }
+    std::copy(labeling.begin(), labeling.end(), first);
+}
+
+bool DenseLabeling::equal(const GmModelIdx& idx, const std::vector<int>& labeling) const {
+    return (int) labeling.size() == this->size(idx) && std::equal(labeling.begin(), labeling.end(), this->at(idx));
+}
+
+bool DenseLabeling::equal(const GmModelIdx& idx, const DenseLabeling& other) const {
+    const int* first = this->at(idx);
+    return std::equal(first, first + this->size(idx), other.at(idx));
+}
+
+bool DenseLabeling::same_layout(const DenseLabeling& other) const {
+    return this->no_nodes == other.no_nodes && this->offsets == other.offsets;
+}
+
+Labeling DenseLabeling::to_labeling() const {
+    Labeling res;
+    res.reserve(this->keys_.size());
+    for (const auto& idx : this->keys_) {
+        res.emplace(idx, this->to_vector(idx));
+    }
+    return res;
+}
+
+size_t DenseLabeling::memory_usage() const {
+    return details::vector_bytes(this->labels_) + details::vector_bytes(this->offsets)
+            + details::vector_bytes(this->keys_) + details::vector_bytes(this->no_nodes);
+}
+
 MgmSolution::MgmSolution(std::shared_ptr<MgmModel> model) : model(model) {}
 
-const Labeling& MgmSolution::labeling() const{
+const DenseLabeling& MgmSolution::dense_labeling() const {
     if (this->labeling_valid) {
         return this->labeling_;
     }
@@ -99,27 +252,32 @@ const Labeling& MgmSolution::labeling() const{
     // Convert from clique table representation
     assert(this->clique_table_valid); 
 
-    Labeling res = this->create_empty_labeling();
+    DenseLabeling res = this->create_empty_dense_labeling();
 
     for (const auto& c : this->ct) {
         for (const auto& [g1, n1] : c) {
             for (const auto& [g2, n2] : c) {
-                if (g1 == g2) 
+                if (g1 >= g2 || !res.contains(GmModelIdx(g1, g2))) 
                     continue;
-                if (g1 < g2) {
-                    res[GmModelIdx(g1,g2)][n1] = n2;
-                }
-                else {
-                    res[GmModelIdx(g2,g1)][n2] = n1;
-                }
+                res.at(GmModelIdx(g1, g2))[n1] = n2;
             }
         }
     }
-    this->labeling_ = res;
+    this->invalidate_changed(res);
+    this->labeling_ = std::move(res);
     this->labeling_valid = true;
     return this->labeling_;
 }
 
+const Labeling& MgmSolution::labeling() const {
+    const auto& dense = this->dense_labeling(); // May invalidate the map
+    if (!this->labeling_map_valid) {
+        this->labeling_map = dense.to_labeling();
+        this->labeling_map_valid = true;
+    }
+    return this->labeling_map;
+}
+
 const CliqueManager& MgmSolution::clique_manager() const {
     if (this->clique_manager_valid) {
         return this->cm;
@@ -151,11 +309,11 @@ const CliqueTable& MgmSolution::clique_table() const {
 }
 
 void MgmSolution::set_solution(const Labeling &labeling) {
-    this->labeling_ = labeling;
+    this->set_solution(DenseLabeling(this->model->graphs, labeling));
+}
 
-    this->labeling_valid        = true;
-    this->clique_manager_valid  = false;
-    this->clique_table_valid    = false;
+void MgmSolution::set_solution(const DenseLabeling &labeling) {
+    this->set_solution(DenseLabeling(labeling));
 }
 
 void MgmSolution::set_solution(const CliqueManager &clique_manager) {
@@ -163,6 +321,7 @@ void MgmSolution::set_solution(const CliqueManager &clique_manager) {
     this->ct = clique_manager.cliques;
     
     this->labeling_valid        = false;
+    this->labeling_map_valid    = false;
     this->clique_manager_valid  = true;
     this->clique_table_valid    = true;
 }
@@ -171,14 +330,25 @@ void MgmSolution::set_solution(const CliqueTable &clique_table) {
     this->ct = clique_table;
 
     this->labeling_valid        = false;
+    this->labeling_map_valid    = false;
     this->clique_manager_valid  = false;
     this->clique_table_valid    = true;
 }
 
 void MgmSolution::set_solution(Labeling&& labeling) {
+    this->set_solution(DenseLabeling(this->model->graphs, labeling));
+
+    // Already in map form.
+    this->labeling_map          = std::move(labeling);
+    this->labeling_map_valid    = true;
+}
+
+void MgmSolution::set_solution(DenseLabeling&& labeling) {
+    this->invalidate_changed(labeling);
     this->labeling_ = std::move(labeling);
 
     this->labeling_valid        = true;
+    this->labeling_map_valid    = false;
     this->clique_manager_valid  = false;
     this->clique_table_valid    = false;
 }
@@ -188,6 +358,7 @@ void MgmSolution::set_solution(CliqueManager&& clique_manager) {
     this->ct = this->cm.cliques;
     
     this->labeling_valid        = false;
+    this->labeling_map_valid    = false;
     this->clique_manager_valid  = true;
     this->clique_table_valid    = true;
 }
@@ -196,14 +367,31 @@ void MgmSolution::set_solution(CliqueTable&& clique_table) {
     this->ct = std::move(clique_table);
 
     this->labeling_valid        = false;
+    this->labeling_map_valid    = false;
     this->clique_manager_valid  = false;
     this->clique_table_valid    = true;
 }
 
 void MgmSolution::set_solution(const GmModelIdx &idx, std::vector<int> labeling)
 {
-    this->labeling_[idx] = labeling;
+    if (!this->labeling_valid) {
+        if (this->clique_table_valid) {
+            this->dense_labeling(); // Other pairs have to be valid, before the clique representations are dropped.
+        }
+        else {
+            this->labeling_ = this->create_empty_dense_labeling();
+            this->labeling_valid = true;
+        }
+    }
+    if (this->energies_.count(idx) > 0 && !this->labeling_.equal(idx, labeling)) {
+        this->energies_.erase(idx);
+        this->total_energy_valid = false;
+    }
+    this->labeling_.assign(idx, labeling);
 
+    if (this->labeling_map_valid) {
+        this->labeling_map[idx] = std::move(labeling);
+    }
     this->clique_manager_valid = false;
     this->clique_table_valid = false;
 }
@@ -211,15 +399,21 @@ void MgmSolution::set_solution(const GmModelIdx &idx, std::vector<int> labeling)
 void MgmSolution::set_solution(const GmSolution &sub_solution)
 {
     GmModelIdx idx = GmModelIdx(sub_solution.model->graph1.id, sub_solution.model->graph2.id);
+
+    // GmModels of a view carry the ids of the root model.
+    if (const auto* view = dynamic_cast<const MgmModelView*>(this->model.get())) {
+        idx = GmModelIdx(view->local_id(idx.first), view->local_id(idx.second));
+    }
     this->set_solution(idx, sub_solution.labeling());
 }
 
 Labeling MgmSolution::create_empty_labeling() const
 {
+    auto keys = this->model->model_keys();
     auto res = Labeling();
-    res.reserve(this->model->models.size());
+    res.reserve(keys.size());
 
-    for (const auto& [idx, m] : this->model->models) {
+    for (const auto& idx : keys) {
         auto labeling_size = this->model->graphs[idx.first].no_nodes;
         res.emplace(idx, std::vector<int>(labeling_size, -1));
     }
@@ -227,37 +421,142 @@ Labeling MgmSolution::create_empty_labeling() const
     return res;
 }
 
+DenseLabeling MgmSolution::create_empty_dense_labeling() const
+{
+    return DenseLabeling(this->model->graphs, this->model->model_keys());
+}
+
+EnergyDelta MgmSolution::energy_delta() const {
+    return EnergyDelta(this->model, this->clique_table());
+}
+
 const std::vector<int> &MgmSolution::operator[](GmModelIdx idx) const {
     return this->labeling().at(idx);
 }
 
 double MgmSolution::evaluate() const {
+    this->dense_labeling(); // Drops cached energies of changed pairs.
+    if (this->total_energy_valid) {
+        return this->total_energy;
+    }
+    auto keys = this->model->model_keys();
+    this->evaluate_missing(keys);
+
+    // Serial sum in order of the keys, so the result is the same for any number of threads.
     double result = 0.0;
-    for (const auto& [idx, m] : this->model->models) {
-        // TODO: Unnecessary vector copying to construct gm solution
-        GmSolution gm_sol(m, this->labeling().at(idx));
-        result += gm_sol.evaluate();
+    for (const auto& idx : keys) {
+        result += this->energies_.at(idx);
     }
+    this->total_energy = result;
+    this->total_energy_valid = true;
     return result;
 }
 
 double MgmSolution::evaluate(int graph_id) const {
-    double result = 0.0;
-    for (const auto& [idx, m] : this->model->models) {
+    this->dense_labeling(); // Drops cached energies of changed pairs.
+
+    std::vector<GmModelIdx> keys;
+    for (const auto& idx : this->model->model_keys()) {
         if (idx.first == graph_id || idx.second == graph_id) {
-            // TODO: Unnecessary vector copying to construct gm solution
-            GmSolution gm_sol(m, this->labeling().at(idx));
-            result += gm_sol.evaluate();
+            keys.push_back(idx);
         }
     }
+    this->evaluate_missing(keys);
+
+    double result = 0.0;
+    for (const auto& idx : keys) {
+        result += this->energies_.at(idx);
+    }
     return result;
 }
 
+double MgmSolution::evaluate(const GmModelIdx& idx) const {
+    const auto& labeling = this->dense_labeling(); // May drop cached energies, so look up afterwards.
+
+    auto it = this->energies_.find(idx);
+    if (it != this->energies_.end()) {
+        return it->second;
+    }
+    double energy = GmSolution::evaluate(*this->model->gm_model_at(idx.first, idx.second), labeling.at(idx));
+    this->energies_.emplace(idx, energy);
+    return energy;
+}
+
+void MgmSolution::evaluate_missing(const std::vector<GmModelIdx>& keys) const {
+    std::vector<GmModelIdx> missing;
+    for (const auto& idx : keys) {
+        if (this->energies_.find(idx) == this->energies_.end()) {
+            missing.push_back(idx);
+        }
+    }
+    if (missing.empty()) {
+        return;
+    }
+
+    // Look up outside of the parallel region, where exceptions can't propagate.
+    // Lazy models are loaded here and stay in memory until the loop is done, whatever the memory budget.
+    std::vector<const int*> labelings;
+    std::vector<std::shared_ptr<GmModel>> models;
+    labelings.reserve(missing.size());
+    models.reserve(missing.size());
+    for (const auto& idx : missing) {
+        labelings.push_back(this->dense_labeling().at(idx));
+        models.push_back(this->model->gm_model_at(idx.first, idx.second));
+    }
+
+    std::vector<double> energies(missing.size());
+    int threads = (MgmSolution::evaluation_threads > 0) ? MgmSolution::evaluation_threads : omp_get_max_threads();
+
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) if(missing.size() > 1)
+    for (size_t i = 0; i < missing.size(); i++) {
+        energies[i] = GmSolution::evaluate(*models[i], labelings[i]);
+    }
+
+    for (size_t i = 0; i < missing.size(); i++) {
+        this->energies_.emplace(missing[i], energies[i]);
+    }
+}
+
+void MgmSolution::invalidate_changed(const DenseLabeling& labeling) const {
+    if (this->energies_.empty()) {
+        return;
+    }
+    if (!labeling.same_layout(this->labeling_)) {
+        this->energies_.clear();
+        this->total_energy_valid = false;
+        return;
+    }
+    for (auto it = this->energies_.begin(); it != this->energies_.end();) {
+        if (labeling.equal(it->first, this->labeling_)) {
+            ++it;
+        }
+        else {
+            it = this->energies_.erase(it);
+            this->total_energy_valid = false;
+        }
+    }
+}
+
+MemoryUsage MgmSolution::memory_usage() const {
+    size_t map_bytes = details::node_map_bytes(this->labeling_map);
+    for (const auto& [key, l] : this->labeling_map) {
+        map_bytes += details::vector_bytes(l);
+    }
+
+    MemoryUsage usage;
+    usage.add("labeling", this->labeling_.memory_usage());
+    usage.add("labeling_map", map_bytes);
+    usage.add("clique_manager", this->cm.memory_usage());
+    usage.add("clique_table", this->ct.memory_usage());
+    usage.add("energies", details::node_map_bytes(this->energies_));
+    return usage;
+}
+
 // bool MgmSolution::is_cycle_consistent() const{
 //     return true;
 // }
 
-mgm::CliqueTable clique_table_from_labeling(mgm::Labeling &labeling, std::vector<mgm::Graph> &graphs) {
+mgm::CliqueTable clique_table_from_labeling(const mgm::DenseLabeling &labeling, const std::vector<mgm::Graph> &graphs) {
     CliqueTable res(graphs.size());
 
     // 2d array to store clique_idx of every node
@@ -272,11 +571,12 @@ mgm::CliqueTable clique_table_from_labeling(mgm::Labeling &labeling, std::vector
             GmModelIdx model_idx(g1,g2);
 
             // no labeling for model
-            if (labeling.find(model_idx) == labeling.end())
+            if (!labeling.contains(model_idx))
                 continue;
             
-            for (size_t node_id = 0; node_id < labeling[model_idx].size(); node_id++) {
-                const int & label = labeling[model_idx][node_id];
+            const int* l = labeling.at(model_idx);
+            for (size_t node_id = 0; node_id < (size_t) labeling.size(model_idx); node_id++) {
+                const int & label = l[node_id];
                 if (label < 0) 
                     continue;
                 
@@ -1,25 +1,84 @@
 #ifndef LIBMGM_SOLUTION_HPP
 #define LIBMGM_SOLUTION_HPP
 
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 #include <memory>
 #include <utility>
 
 #include "cliques.hpp"
+#include "energy_delta.hpp"
 #include "multigraph.hpp"
 
 namespace mgm {
 
 using Labeling = std::unordered_map<GmModelIdx, std::vector<int>, GmModelIdxHash>;
 
+// Labelings of all graph pairs in a single buffer.
+// Pairs are stored in upper triangular order (0,1), (0,2), ..., (1,2), ... Each pair (g1, g2) takes
+// graphs[g1].no_nodes labels. Pairs, which are not contained, take no space.
+class DenseLabeling {
+    public:
+        DenseLabeling() = default;
+
+        // All nodes unassigned for the pairs in `keys`.
+        DenseLabeling(const std::vector<Graph>& graphs, const std::vector<GmModelIdx>& keys);
+
+        // Throws std::invalid_argument, if a labeling doesn't match the size of its first graph.
+        DenseLabeling(const std::vector<Graph>& graphs, const Labeling& labeling);
+
+        bool contains(const GmModelIdx& idx) const;
+
+        // First label of a pair. Throws std::out_of_range, if the pair is not contained.
+        int* at(const GmModelIdx& idx);
+        const int* at(const GmModelIdx& idx) const;
+
+        // Number of labels of a pair
+        int size(const GmModelIdx& idx) const { return this->no_nodes[idx.first]; }
+
+        std::vector<int> to_vector(const GmModelIdx& idx) const;
+        void assign(const GmModelIdx& idx, const std::vector<int>& labeling);
+
+        bool equal(const GmModelIdx& idx, const std::vector<int>& labeling) const;
+        bool equal(const GmModelIdx& idx, const DenseLabeling& other) const;
+
+        Labeling to_labeling() const;
+
+        // Contained pairs, in storage order.
+        const std::vector<GmModelIdx>& keys() const { return this->keys_; }
+
+        // All labels, e.g. to copy them at once. Pairs start at offset(idx).
+        const std::vector<int>& labels() const { return this->labels_; }
+        size_t offset(const GmModelIdx& idx) const;
+
+        // Same graphs and pairs.
+        bool same_layout(const DenseLabeling& other) const;
+
+        size_t memory_usage() const;
+
+    private:
+        int no_graphs = 0;
+        std::vector<int> no_nodes;
+        std::vector<GmModelIdx> keys_;
+
+        // Per pair, indexed by details::pair_index. -1, if the pair is not contained.
+        std::vector<std::int64_t> offsets;
+        std::vector<int> labels_;
+};
+
 class GmSolution {
     public:
         GmSolution() = default;
         GmSolution(std::shared_ptr<GmModel> model);
         GmSolution(std::shared_ptr<GmModel> model, std::vector<int> labeling);
 
+        // Cost scales with the number of labeled nodes times their degree.
         static double evaluate(const GmModel& model, const std::vector<int>& labeling);
+        static double evaluate(const GmModel& model, const int* labeling); // graph1.no_nodes labels
+
+        // Scans all edges of the model. Reference implementation for testing evaluate().
+        static double evaluate_reference(const GmModel& model, const std::vector<int>& labeling);
         double evaluate() const;
 
         int& operator[](int idx); // access labeling
@@ -33,6 +92,9 @@ class GmSolution {
     private:
         bool is_active(AssignmentIdx assignment) const;
         static bool is_active(const AssignmentIdx& assignment, const std::vector<int>& labeling);
+        static bool is_active(const AssignmentIdx& assignment, const int* labeling);
+
+        static double evaluate(const GmModel& model, const int* labeling, int size);
 
         std::vector<int> labeling_;
 };
@@ -44,23 +106,33 @@ class MgmSolution {
         //std::unordered_map<GmModelIdx, GmSolution, GmModelIdxHash> gmSolutions;
         std::shared_ptr<MgmModel> model;
 
+        // Threads used by evaluate(). 0: OpenMP default, see omp_set_num_threads.
+        static inline int evaluation_threads = 0;
+
         const std::vector<int>& operator[](GmModelIdx idx) const;
 
+        // Energies are cached per pair. Only pairs, whose labeling changed by set_solution, are reevaluated.
+        // Pairs are evaluated in parallel. The sum is taken in a fixed order, independent of the number of threads.
         double evaluate() const;
         double evaluate(int graph_id) const; // limit cost evaluation to models with graph `graph_id`.
+        double evaluate(const GmModelIdx& idx) const; // single pair
         //bool is_cycle_consistent() const;
 
         // A solution can be represented in multiple valid ways
         // This class uses lazy evaluation and converts between different forms on demand.
+        // Labelings are stored as DenseLabeling. The Labeling map is built on request only.
         const Labeling&        labeling()          const;
+        const DenseLabeling&   dense_labeling()    const;
         const CliqueManager&   clique_manager()    const;
         const CliqueTable&     clique_table()      const;
 
         void set_solution(const Labeling& labeling);
+        void set_solution(const DenseLabeling& labeling);
         void set_solution(const CliqueManager& clique_manager);
         void set_solution(const CliqueTable& clique_table);
 
         void set_solution(Labeling&& labeling);
+        void set_solution(DenseLabeling&& labeling);
         void set_solution(CliqueManager&& clique_manager);
         void set_solution(CliqueTable&& clique_table);
 
@@ -68,16 +140,37 @@ class MgmSolution {
         void set_solution(const GmSolution& sub_solution);
 
         Labeling create_empty_labeling() const;
+        DenseLabeling create_empty_dense_labeling() const;
+
+        // Energy changes of clique moves on clique_table(). Valid until the solution changes.
+        EnergyDelta energy_delta() const;
+
+        // Includes all cached representations, not the model.
+        MemoryUsage memory_usage() const;
     private:
 
         mutable bool labeling_valid         = false;
         mutable bool clique_manager_valid   = false;
         mutable bool clique_table_valid     = false;
 
-        mutable Labeling        labeling_;
+        mutable DenseLabeling   labeling_;
         mutable CliqueManager   cm;
         mutable CliqueTable     ct;
 
+        // Map form of labeling_, built by labeling().
+        mutable Labeling        labeling_map;
+        mutable bool            labeling_map_valid = false;
+
+        // Energy per pair, matching the current content of labeling_. Missing pairs are dirty.
+        mutable std::unordered_map<GmModelIdx, double, GmModelIdxHash> energies_;
+        mutable bool    total_energy_valid = false;
+        mutable double  total_energy;
+
+        // Drops cached energies of pairs, whose labeling differs from `labeling`.
+        void invalidate_changed(const DenseLabeling& labeling) const;
+
+        // Evaluates pairs without cached energy in parallel and caches them.
+        void evaluate_missing(const std::vector<GmModelIdx>& keys) const;
 
 };
 
@@ -44,5 +44,6 @@ namespace mgm {
         
         auto local_searcher = GMLocalSearcher(this->model, search_order);
         (void) local_searcher.search(this->current_state);
+        details::keep_peak(this->peak_matching_memory_, local_searcher.peak_matching_memory());
     }
 }
@@ -87,8 +87,10 @@ void SequentialGenerator::step() {
     const CliqueManager& current  = this->current_state.clique_manager();
     const CliqueManager& next     = this->generation_queue.front();
 
-    GmSolution solution         = details::match(current, next, (*this->model));
+    MemoryUsage usage;
+    GmSolution solution         = details::match(current, next, (*this->model), &usage);
     CliqueManager new_manager   = details::merge(current, next, solution, (*this->model));
+    details::keep_peak(this->peak_matching_memory_, usage);
 
     this->current_state.set_solution(std::move(new_manager));
     this->generation_queue.pop();
@@ -132,8 +134,11 @@ CliqueManager ParallelGenerator::parallel_task(std::vector<CliqueManager> sub_ge
     if (list_length == 2) {
         spdlog::debug("Merging: {} and {}", sub_generation[0].graph_ids, sub_generation[1].graph_ids);
 
-        GmSolution solution        = details::match(sub_generation[0], sub_generation[1], (*this->model));
+        MemoryUsage usage;
+        GmSolution solution        = details::match(sub_generation[0], sub_generation[1], (*this->model), &usage);
         CliqueManager new_manager  = details::merge(sub_generation[0], sub_generation[1], solution, (*this->model));
+        #pragma omp critical(peak_matching_memory)
+        details::keep_peak(this->peak_matching_memory_, usage);
         return new_manager;
     } else if (list_length == 1) {
         return sub_generation[0];
@@ -171,8 +176,11 @@ CliqueManager ParallelGenerator::parallel_task(std::vector<CliqueManager> sub_ge
 
     spdlog::debug("Merging: {} and {}", a.graph_ids, b.graph_ids);
 
-    GmSolution solution         = details::match(a, b, (*this->model));
+    MemoryUsage usage;
+    GmSolution solution         = details::match(a, b, (*this->model), &usage);
     new_manager                 = details::merge(a, b, solution, (*this->model));
+    #pragma omp critical(peak_matching_memory)
+    details::keep_peak(this->peak_matching_memory_, usage);
     
 
     return new_manager;
@@ -180,11 +188,21 @@ CliqueManager ParallelGenerator::parallel_task(std::vector<CliqueManager> sub_ge
 
 namespace details {
     
-GmSolution match(const CliqueManager& manager_1, const CliqueManager& manager_2, const MgmModel& model){
+GmSolution match(const CliqueManager& manager_1, const CliqueManager& manager_2, const MgmModel& model, MemoryUsage* usage){
 
     spdlog::info("Matching {} <-- {}", manager_1.graph_ids, manager_2.graph_ids);
+    if (usage) {
+        usage->add("clique_manager_1", manager_1.memory_usage());
+        usage->add("clique_manager_2", manager_2.memory_usage());
+    }
     CliqueMatcher matcher(manager_1, manager_2, model);
-    return matcher.match();
+    return matcher.match(usage);
+}
+
+void keep_peak(MemoryUsage& peak, const MemoryUsage& usage) {
+    if (usage.total() > peak.total()) {
+        peak = usage;
+    }
 }
 
 //FIXME: could also be done inplace into manager_1
@@ -260,8 +278,9 @@ CliqueMatcher::CliqueMatcher(const CliqueManager& manager_1, const CliqueManager
     // Approximate needed memory
     GmModelIdx graph_pair_idx = (g1 < g2) ? GmModelIdx(g1, g2) : GmModelIdx(g2, g1);
 
-    size_t approximate_no_assignments_max = this->model.models.at(graph_pair_idx)->no_assignments();
-    size_t approximate_no_edges_max = this->model.models.at(graph_pair_idx)->no_edges();
+    const auto m = this->model.gm_model_at(graph_pair_idx.first, graph_pair_idx.second);
+    size_t approximate_no_assignments_max = m->no_assignments();
+    size_t approximate_no_edges_max = m->no_edges();
 
     this->clique_assignments.reserve(approximate_no_assignments_max);
     this->clique_edges.reserve(approximate_no_edges_max);
@@ -269,8 +288,11 @@ CliqueMatcher::CliqueMatcher(const CliqueManager& manager_1, const CliqueManager
     spdlog::info("Constructed CliqueMatcher");
 }
 
-GmSolution CliqueMatcher::match() {
+GmSolution CliqueMatcher::match(MemoryUsage* usage) {
     auto model = std::make_shared<GmModel>(this->construct_qap());
+    if (usage) {
+        usage->add("model", model->memory_usage());
+    }
 
     if (model->no_edges() == 0) {
         spdlog::info("No edges. Constructing LAP solver...");
@@ -282,6 +304,9 @@ GmSolution CliqueMatcher::match() {
     else {
         spdlog::info("Constructing QAP solver...");
         QAPSolver solver(model);
+        if (usage) {
+            usage->add("qap_solver", solver.memory_usage());
+        }
 
         spdlog::info("Running QAP solver...");
         return solver.run();
@@ -309,12 +334,14 @@ void CliqueMatcher::collect_assignments() {
             bool is_sorted = (g1 < g2);
             GmModelIdx graph_pair_idx = is_sorted ? GmModelIdx(g1, g2) : GmModelIdx(g2, g1);
 
-            auto m = this->model.models.at(graph_pair_idx);
+            const auto& m = this->model.gm_model_at(graph_pair_idx.first, graph_pair_idx.second);
 
             int clique_g1 = -1, clique_g2 = -1;
 
             // Iterate over all assignments
-            for (const auto& a : m->assignment_list) {
+            const auto& unaries = m->costs->unary_costs();
+            for (size_t a_id = 0; a_id < m->assignment_list.size(); a_id++) {
+                const auto& a = m->assignment_list[a_id];
                 if (is_sorted) {
                     clique_g1 = this->manager_1.clique_idx(g1, a.first);
                     clique_g2 = this->manager_2.clique_idx(g2, a.second);
@@ -325,7 +352,7 @@ void CliqueMatcher::collect_assignments() {
                 }
                 assert(clique_g1 >= 0);
                 assert(clique_g2 >= 0);
-                double cost = m->costs->unary(a);
+                double cost = unaries[a_id];
 
                 // Store as an assignment between two cliques.
                 // Other graph pairs with an assignment in the same cliques may add a cost later.
@@ -365,48 +392,61 @@ void CliqueMatcher::collect_edges() {
             bool is_sorted = (g1 < g2);
             GmModelIdx graph_pair_idx = is_sorted ? GmModelIdx(g1, g2) : GmModelIdx(g2, g1);
 
-            auto m = this->model.models.at(graph_pair_idx);
+            const auto& m = this->model.gm_model_at(graph_pair_idx.first, graph_pair_idx.second);
+
+            // Iterate over all edges, row by row of the frozen layout.
+            const auto& edges = m->edges();
+            for (int a1_id = 0; a1_id < edges.no_rows(); a1_id++) {
+                const AssignmentIdx& a1 = m->assignment_list[a1_id];
 
-            // Iterate over all edges
-            for (const auto& [edge_idx, cost] : m->costs->all_edges()) {
-                const AssignmentIdx& a1    = edge_idx.first;
-                const AssignmentIdx& a2    = edge_idx.second;
-                
                 int clique_a1_n1;
                 int clique_a1_n2;
-                int clique_a2_n1;
-                int clique_a2_n2;
 
                 // Map assignment nodes onto cliques.
                 if (is_sorted) {
                     clique_a1_n1 = this->manager_1.clique_idx(g1, a1.first);
                     clique_a1_n2 = this->manager_2.clique_idx(g2, a1.second);
-                    clique_a2_n1 = this->manager_1.clique_idx(g1, a2.first);
-                    clique_a2_n2 = this->manager_2.clique_idx(g2, a2.second);
                 }
                 else {
                     clique_a1_n1 = this->manager_1.clique_idx(g1, a1.second);
                     clique_a1_n2 = this->manager_2.clique_idx(g2, a1.first);
-                    clique_a2_n1 = this->manager_1.clique_idx(g1, a2.second);
-                    clique_a2_n2 = this->manager_2.clique_idx(g2, a2.first);
                 }
                 assert(clique_a1_n1 >= 0);
                 assert(clique_a1_n2 >= 0);
-                assert(clique_a2_n1 >= 0);
-                assert(clique_a2_n2 >= 0);
 
-                // Find the two pairs of cliques that the edge refers to.
                 CliqueAssignmentIdx clique_a1(clique_a1_n1, clique_a1_n2);
-                CliqueAssignmentIdx clique_a2(clique_a2_n1, clique_a2_n2);
 
-                // Check if the two clique pairs are both present in the clique assignments.
+                // Check if the clique pair is present in the clique assignments.
                 // (May have been removed due to infinity assignments between them)
-                auto it_c1 = this->clique_assignments.find(clique_a1);
-                auto it_c2 = this->clique_assignments.find(clique_a2);
-
-                if ((it_c1 != this->clique_assignments.end()) && (it_c2 != this->clique_assignments.end())) {
-                    EdgeIdx e(clique_a1, clique_a2);
-                    this->clique_edges[e] += cost; // Default value-initializes to zero, according to standard.
+                if (edges.offsets[a1_id] == edges.offsets[a1_id+1] || 
+                    this->clique_assignments.find(clique_a1) == this->clique_assignments.end())
+                    continue;
+
+                for (int i = edges.offsets[a1_id]; i < edges.offsets[a1_id+1]; i++) {
+                    const AssignmentIdx& a2 = m->assignment_list[edges.neighbours[i]];
+                    double cost             = edges.costs[i];
+
+                    int clique_a2_n1;
+                    int clique_a2_n2;
+
+                    if (is_sorted) {
+                        clique_a2_n1 = this->manager_1.clique_idx(g1, a2.first);
+                        clique_a2_n2 = this->manager_2.clique_idx(g2, a2.second);
+                    }
+                    else {
+                        clique_a2_n1 = this->manager_1.clique_idx(g1, a2.second);
+                        clique_a2_n2 = this->manager_2.clique_idx(g2, a2.first);
+                    }
+                    assert(clique_a2_n1 >= 0);
+                    assert(clique_a2_n2 >= 0);
+
+                    // Find the second pair of cliques that the edge refers to.
+                    CliqueAssignmentIdx clique_a2(clique_a2_n1, clique_a2_n2);
+
+                    if (this->clique_assignments.find(clique_a2) != this->clique_assignments.end()) {
+                        EdgeIdx e(clique_a1, clique_a2);
+                        this->clique_edges[e] += cost; // Default value-initializes to zero, according to standard.
+                    }
                 }
             }
         }
@@ -434,6 +474,7 @@ GmModel CliqueMatcher::construct_gm_model() {
         auto & a2 = edge_idx.second;
         m.add_edge(a1.first, a1.second, a2.first, a2.second, cost);
     }
+    m.freeze();
 
     return m;
 }  
@@ -7,6 +7,7 @@
 #include <queue>
 
 #include "cliques.hpp"
+#include "memory_usage.hpp"
 #include "multigraph.hpp"
 #include "solution.hpp"
 
@@ -19,6 +20,9 @@ class MgmGenerator {
             random
         };
 
+        // Largest clique-to-clique matching so far, see details::match.
+        const MemoryUsage& peak_matching_memory() const { return this->peak_matching_memory_; }
+
     protected:
         MgmGenerator(std::shared_ptr<MgmModel> model);
         virtual ~MgmGenerator() = default;
@@ -30,6 +34,8 @@ class MgmGenerator {
 
         MgmSolution current_state;
         std::shared_ptr<MgmModel> model;
+
+        MemoryUsage peak_matching_memory_;
 };
 
 class SequentialGenerator : public MgmGenerator {
@@ -63,7 +69,11 @@ namespace details {
 //FIXME: Try to remove this MgmModel& dependency.
 // Maybe not ideal to have these functions outside any class.
 // Needed for MgmSolver and Local searcher (-> Parent class maybe?)
-GmSolution match(const CliqueManager& manager_1, const CliqueManager& manager_2, const MgmModel& model);
+// If `usage` is given, it receives the memory of the matching: both clique managers, the clique-to-clique model and its solver.
+GmSolution match(const CliqueManager& manager_1, const CliqueManager& manager_2, const MgmModel& model, MemoryUsage* usage=nullptr);
+
+// Keeps the larger of both in `peak`, by total.
+void keep_peak(MemoryUsage& peak, const MemoryUsage& usage);
 CliqueManager merge(const CliqueManager& manager_1, const CliqueManager& manager_2, const GmSolution& solution, const MgmModel& model);
 std::pair<CliqueManager, CliqueManager> split(const CliqueManager& manager, int graph_id, const MgmModel& model); // Splits off graph [graph_id] from manager
         
@@ -71,7 +81,7 @@ std::pair<CliqueManager, CliqueManager> split(const CliqueManager& manager, int
 class CliqueMatcher {
     public:
         CliqueMatcher(const CliqueManager& manager_1, const CliqueManager& manager_2, const MgmModel& model);
-        GmSolution match();
+        GmSolution match(MemoryUsage* usage=nullptr);
 
     private:
         const CliqueManager& manager_1;
@@ -11,6 +11,7 @@
 #include "solver_generator_mgm.hpp"
 #include "random_singleton.hpp"
 #include "solution.hpp"
+#include "energy_delta.hpp"
 
 #include "solver_local_search_GM.hpp"
 namespace mgm
@@ -61,16 +62,16 @@ namespace mgm
 
             auto managers = details::split(this->current_state->get().clique_manager(), graph_id, (*this->model));
 
-            GmSolution sol              = details::match(managers.first, managers.second, (*this->model));
+            MemoryUsage usage;
+            GmSolution sol              = details::match(managers.first, managers.second, (*this->model), &usage);
             CliqueManager new_manager   = details::merge(managers.first, managers.second, sol, (*this->model));
+            details::keep_peak(this->peak_matching_memory_, usage);
 
             // check if improved
             auto graph_energy_prev = this->current_state->get().evaluate(graph_id);
             spdlog::info("graph_energy_prev: {}", graph_energy_prev);
             
-            auto mgm_sol = MgmSolution(model);
-            mgm_sol.set_solution(new_manager);
-            auto graph_energy_new = mgm_sol.evaluate(graph_id);
+            auto graph_energy_new = EnergyDelta::graph_energy(*this->model, new_manager.cliques, graph_id);
             
             spdlog::info("graph_energy_new: {}", graph_energy_new);
 
@@ -174,6 +175,9 @@ namespace mgm
         spdlog::info("Solving local search for all graphs in parallel...");
         const auto& curr_manager = this->current_state->get().clique_manager();
 
+        // Fills the energy cache. Within the parallel region, evaluate(graph_id) then only reads it.
+        this->current_state->get().evaluate();
+
         // Disable info logging for the duration of multithreading.
         // Clutters the log otherwise.
         auto log_level = spdlog::get_level();
@@ -188,20 +192,20 @@ namespace mgm
 
                 auto managers = details::split_unpruned(curr_manager, graph_id, (*this->model));
 
-                GmSolution sol              = details::match(managers.first, managers.second, (*this->model));
+                MemoryUsage usage;
+                GmSolution sol              = details::match(managers.first, managers.second, (*this->model), &usage);
                 CliqueManager new_manager   = details::merge(managers.first, managers.second, sol, (*this->model));
                 
                 auto graph_energy_prev = this->current_state->get().evaluate(graph_id);
            
-                auto mgm_sol = MgmSolution(model);
-                mgm_sol.set_solution(new_manager);
-                auto graph_energy_new = mgm_sol.evaluate(graph_id);
+                auto graph_energy_new = EnergyDelta::graph_energy(*this->model, new_manager.cliques, graph_id);
 
                 double energy = this->current_energy + (graph_energy_new - graph_energy_prev);
 
                 #pragma omp critical
                 {
                     this->matchings.push_back(std::make_tuple(graph_id, std::move(sol), std::move(new_manager), energy));
+                    details::keep_peak(this->peak_matching_memory_, usage);
                 }
             }
         }
@@ -246,9 +250,7 @@ namespace mgm
                 // Overwrite solution, if improved.               
                 auto graph_energy_prev = this->current_state->get().evaluate(graph_id);
            
-                auto mgm_sol = MgmSolution(model);
-                mgm_sol.set_solution(new_manager);
-                auto graph_energy_new = mgm_sol.evaluate(graph_id);
+                auto graph_energy_new = EnergyDelta::graph_energy(*this->model, new_manager.cliques, graph_id);
 
                 double energy = this->current_energy + (graph_energy_new - graph_energy_prev);
 
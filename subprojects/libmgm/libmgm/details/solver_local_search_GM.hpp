@@ -27,6 +27,9 @@ class GMLocalSearcher {
         bool search(MgmSolution& input);
         bool search(MgmSolution&& input) = delete; //Prevent search(MgmSolution()) and search(std::move(input))
 
+        // Largest clique-to-clique matching so far, see details::match.
+        const MemoryUsage& peak_matching_memory() const { return this->peak_matching_memory_; }
+
     private:
         int current_step = 0;
         double previous_energy = INFINITY_COST;
@@ -40,6 +43,8 @@ class GMLocalSearcher {
 
         int last_improved_graph = -1;
         bool should_stop();
+
+        MemoryUsage peak_matching_memory_;
 };
 
 //FIXME: This needs a better name.
@@ -57,6 +62,9 @@ class GMLocalSearcherParallel {
         bool search(MgmSolution& input);
         bool search(MgmSolution&& input) = delete; //Prevent search(MgmSolution()) and search(std::move(input))
 
+        // Largest clique-to-clique matching so far, see details::match.
+        const MemoryUsage& peak_matching_memory() const { return this->peak_matching_memory_; }
+
     private:
         int current_step = 0;
         double previous_energy = INFINITY_COST;
@@ -72,6 +80,8 @@ class GMLocalSearcherParallel {
         bool merge_all;
 
         bool should_stop();
+
+        MemoryUsage peak_matching_memory_;
 };
 
 namespace details {
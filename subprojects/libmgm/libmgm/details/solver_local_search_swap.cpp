@@ -11,7 +11,6 @@
 #include "solver_local_search_swap.hpp"
 #include "solution.hpp"
 
-constexpr double INFINITY_COST = 1e99;
 constexpr double QPBO_ENERGY_THRESHOLD = -0.000001;
 
 namespace mgm {
@@ -32,13 +31,16 @@ bool SwapLocalSearcher::search(MgmSolution& input) {
     bool iteration_improved = true;
     double initial_energy = input.evaluate();
 
+    this->energy_delta = std::make_unique<EnergyDelta>(this->model, this->current_state);
     this->clique_optimizer = std::make_unique<details::CliqueSwapper>(  this->model->no_graphs,
                                                                         this->model, 
                                                                         this->current_state,
+                                                                        *this->energy_delta,
                                                                         this->max_iterations_QPBO_I);
+    this->current_energy = initial_energy;
 
     while (iteration_improved) {
-        spdlog::info("Current energy: {}", initial_energy);
+        spdlog::info("Current energy: {}", this->current_energy);
 
         iteration_improved = this->iterate();
 
@@ -104,32 +106,23 @@ bool SwapLocalSearcher::iterate()
             }
 
             bool should_flip = this->clique_optimizer->optimize(clique_A, clique_B);
+            if (!should_flip || this->clique_optimizer->current_solution.energy >= QPBO_ENERGY_THRESHOLD)
+                continue;
+
+            // Accept on the exact energy change. Equals the QPBO energy up to rounding.
+            auto graphs = details::flipped_graphs(this->clique_optimizer->current_solution);
+            double delta = this->energy_delta->swap(clique_A, clique_B, graphs);
+            spdlog::debug("QPBO Energy: {}, exact change: {}", this->clique_optimizer->current_solution.energy, delta);
 
-            if (should_flip && this->clique_optimizer->current_solution.energy < QPBO_ENERGY_THRESHOLD) {
+            if (delta < QPBO_ENERGY_THRESHOLD) {
                 improved = true;
 
                 this->cliques_changed[idx_A] = true;
                 this->cliques_changed[idx_B] = true;
 
-            #ifndef NDEBUG
-                auto s = MgmSolution(this->model);
-                s.set_solution(this->current_state);
-                double e_prior = s.evaluate();
-                spdlog::debug("Energy before flip: {}", e_prior);
-                double e_qpbo = clique_optimizer->current_solution.energy;
-                spdlog::debug("QPBO Energy: {}", e_qpbo);
-            #endif
-
+                this->energy_delta->apply_swap(clique_A, clique_B, graphs, idx_A, idx_B);
                 details::flip(clique_A, clique_B, this->clique_optimizer->current_solution);
-
-            #ifndef NDEBUG
-                s = MgmSolution(this->model);
-                s.set_solution(this->current_state);
-                double e_after = s.evaluate();
-                spdlog::debug("Energy After flip: {}", e_after);
-                spdlog::debug("Should be: {}", e_prior + e_qpbo);
-                spdlog::debug("Difference: {}", ((e_prior + e_qpbo) - e_after));
-            #endif
+                this->current_energy += delta;
 
                 if (clique_A.empty()) {
                     break;
@@ -141,16 +134,25 @@ bool SwapLocalSearcher::iterate()
             //spdlog::info("Checking against empty clique...");
             bool improved = this->clique_optimizer->optimize_with_empty(clique_A);
                 if (improved) {
-                    spdlog::info("Improvement found. Splitting clique {}.", idx_A);
+                    auto new_clique = CliqueTable::Clique();
+                    auto graphs = details::flipped_graphs(this->clique_optimizer->current_solution);
+                    double delta = this->energy_delta->swap(clique_A, new_clique, graphs);
 
-                    this->cliques_changed[idx_A] = true;
+                    if (delta < QPBO_ENERGY_THRESHOLD) {
+                        spdlog::info("Improvement found. Splitting clique {}.", idx_A);
 
-                    auto new_clique = CliqueTable::Clique();
-                    details::flip(clique_A, new_clique, this->clique_optimizer->current_solution);
+                        this->cliques_changed[idx_A] = true;
 
-                    new_cliques.push_back(new_clique);
+                        // New cliques are added to the table after the iteration. Until then, they take the ids after the table.
+                        int new_clique_id = this->current_state.no_cliques + static_cast<int>(new_cliques.size());
+                        this->energy_delta->apply_swap(clique_A, new_clique, graphs, idx_A, new_clique_id);
+                        details::flip(clique_A, new_clique, this->clique_optimizer->current_solution);
+                        this->current_energy += delta;
 
-                    assert(!clique_A.empty());
+                        new_cliques.push_back(new_clique);
+
+                        assert(!clique_A.empty());
+                    }
                 }
         }
         idx_A++;
@@ -188,17 +190,28 @@ void SwapLocalSearcher::post_iterate_cleanup(std::vector<CliqueTable::Clique>& n
 
     // reset
     this->cliques_changed.assign(this->current_state.no_cliques, false);
+
+    // Clique ids changed.
+    this->energy_delta->rebuild();
+
+    // Full evaluation only for debug output. The tracked energy may differ by rounding.
+    if (spdlog::should_log(spdlog::level::debug)) {
+        auto s = MgmSolution(this->model);
+        s.set_solution(this->current_state);
+        spdlog::debug("Tracked energy: {}, evaluated: {}", this->current_energy, s.evaluate());
+    }
 }
 
 namespace details{
 
 std::vector<int> unique_keys(CliqueTable::Clique &A, CliqueTable::Clique &B, int num_graphs);
 
-CliqueSwapper::CliqueSwapper(int num_graphs, std::shared_ptr<MgmModel> model, CliqueTable& current_state, int max_iterations_QPBO_I) 
+CliqueSwapper::CliqueSwapper(int num_graphs, std::shared_ptr<MgmModel> model, CliqueTable& current_state, EnergyDelta& energy_delta, int max_iterations_QPBO_I) 
     :   qpbo_solver(num_graphs, ((num_graphs*num_graphs) / 2)),
         model(model),
         current_state(current_state),
-        max_iterations_QPBO_I(max_iterations_QPBO_I) {}
+        max_iterations_QPBO_I(max_iterations_QPBO_I),
+        energy_delta(energy_delta) {}
 
 
 bool CliqueSwapper::optimize(CliqueTable::Clique &A, CliqueTable::Clique &B)
@@ -247,12 +260,7 @@ bool CliqueSwapper::optimize(CliqueTable::Clique &A, CliqueTable::Clique &B)
                     auto alpha2   = (alpha2_it != A.end())  ? alpha2_it->second : -1;
                     auto beta2    = (beta2_it != B.end())   ? beta2_it->second  : -1;
 
-                    if (g1 < g2) {
-                        cost += star_flip_cost(g1, g2, alpha1, alpha2, beta1, beta2);
-                    }
-                    else {
-                        cost += star_flip_cost(g2, g1, alpha2, alpha1, beta2, beta1);
-                    }
+                    cost += this->energy_delta.pair(g1, g2, alpha1, alpha2, beta1, beta2);
                 }
             }
 
@@ -310,7 +318,7 @@ bool CliqueSwapper::optimize_no_groups(CliqueTable::Clique &A, CliqueTable::Cliq
             auto beta1    = (beta1_it != B.end())   ? beta1_it->second  : -1;
             auto beta2    = (beta2_it != B.end())   ? beta2_it->second  : -1;
 
-            double cost = star_flip_cost(g1, g2, alpha1, alpha2, beta1, beta2);
+            double cost = this->energy_delta.pair(g1, g2, alpha1, alpha2, beta1, beta2);
             qpbo_solver.AddPairwiseTerm(idx_g1, idx_g2, 0, cost, cost, 0);
 
             idx_g2++;
@@ -352,92 +360,6 @@ bool CliqueSwapper::run_qpbo_solver()
     return success;
 }
 
-inline double get_flip_cost(AssignmentIdx& a, const mgm::AssignmentContainer & assignments) {
-    auto a_it = assignments.find(a);
-    return (a_it != assignments.end() ? a_it->second : INFINITY_COST);
-}
-
-inline EdgeIdx construct_sorted(AssignmentIdx& a, AssignmentIdx& b) {
-    return (a.first < b.first) ? EdgeIdx(a, b): EdgeIdx(b, a);
-}
-
-double CliqueSwapper::star_flip_cost(int id_graph1, int id_graph2, int alpha1, int alpha2, int beta1, int beta2)
-{
-    const auto& m = this->model->models.at(GmModelIdx(id_graph1, id_graph2));
-    double cost = 0.0;
-
-    auto old_assignment_1 = AssignmentIdx(alpha1, alpha2);
-    auto old_assignment_2 = AssignmentIdx(beta1, beta2);
-
-    auto new_assignment_1 = AssignmentIdx(alpha1, beta2);
-    auto new_assignment_2 = AssignmentIdx(beta1, alpha2);
-
-    auto& assignments = m->costs->all_assignments();
-    if (alpha1 != -1) {
-        if(alpha2 != -1) 
-            cost -= get_flip_cost(old_assignment_1, assignments);
-        if(beta2 != -1)
-            cost += get_flip_cost(new_assignment_1, assignments);
-    }
-    if(beta1 != -1) {
-        if(beta2 != -1)
-            cost -= get_flip_cost(old_assignment_2, assignments);
-        if(alpha2 != -1)
-            cost += get_flip_cost(new_assignment_2, assignments);
-    }
-    
-    // pairwise
-    auto& edges = m->costs->all_edges();
-    for (const auto & c : this->current_state) {
-        auto g1_it = c.find(id_graph1);
-        if(g1_it == c.end())
-            continue;
-
-        auto g2_it = c.find(id_graph2);
-        if(g2_it == c.end())
-            continue;
-
-        AssignmentIdx pair(g1_it->second, g2_it->second);
-        if(old_assignment_1 == pair || old_assignment_2 == pair)
-            continue;
-
-        auto old_edge_1 = construct_sorted(old_assignment_1, pair);
-        auto old_edge_2 = construct_sorted(old_assignment_2, pair);
-        auto new_edge_1 = construct_sorted(new_assignment_1, pair);
-        auto new_edge_2 = construct_sorted(new_assignment_2, pair);
-
-        auto e_it = edges.find(old_edge_1);
-        if(e_it != edges.end())
-            cost -= e_it->second;
-
-        e_it = edges.find(old_edge_2);
-        if(e_it != edges.end())
-            cost -= e_it->second;
-
-        e_it = edges.find(new_edge_1);
-        if(e_it != edges.end())
-            cost += e_it->second;
-
-        e_it = edges.find(new_edge_2);
-        if(e_it != edges.end())
-            cost += e_it->second;
-    }
-
-    // account for edge between old and new assignments.
-    auto old_edge = construct_sorted(old_assignment_1, old_assignment_2);
-    auto new_edge = construct_sorted(new_assignment_1, new_assignment_2);
-
-    auto e_it = edges.find(old_edge);
-    if(e_it != edges.end())
-        cost -= e_it->second;
-
-    e_it = edges.find(new_edge);
-    if(e_it != edges.end())
-        cost += e_it->second;
-
-    return cost;
-}
-
 // return SORTED set_union over clique A and clique B keys (keys=graph_id)
 // num_graphs added for convinience to estimate max size of the returned array.
 std::vector<int> unique_keys(CliqueTable::Clique& A, CliqueTable::Clique& B, int num_graphs) {
@@ -496,6 +418,16 @@ void flip(CliqueTable::Clique &A, CliqueTable::Clique &B, CliqueSwapper::Solutio
     }
 }
 
+std::vector<int> flipped_graphs(const CliqueSwapper::Solution & solution) {
+    std::vector<int> graphs;
+    for (size_t i = 0; i < solution.flip_indices.size(); i++) {
+        if (solution.flip_indices[i] == 1) {
+            graphs.insert(graphs.end(), solution.groups[i].begin(), solution.groups[i].end());
+        }
+    }
+    return graphs;
+}
+
 struct SwapGroupManager {
     std::vector<SwapGroup> groups;
     std::unordered_map<int, std::size_t> graph_to_group;
@@ -537,7 +469,7 @@ bool should_merge(const int g1, const SwapGroup& group, const CliqueTable::Cliqu
         bool a2_exists = beta1_it != B.end() && alpha2_it != A.end();
 
         if (g1 < g2){
-            const auto& m = model->models.at(GmModelIdx(g1, g2));
+            const auto& m = model->gm_model_at(g1, g2);
 
             if ((a1_exists && !m->costs->contains(alpha1_it->second, beta2_it->second)) ||
                 (a2_exists && !m->costs->contains(beta1_it->second, alpha2_it->second))) {
@@ -545,7 +477,7 @@ bool should_merge(const int g1, const SwapGroup& group, const CliqueTable::Cliqu
             }
         }
         else{
-            const auto& m = model->models.at(GmModelIdx(g2, g1));
+            const auto& m = model->gm_model_at(g2, g1);
 
             if ((a1_exists && !m->costs->contains(beta2_it->second, alpha1_it->second)) ||
                 (a2_exists && !m->costs->contains(alpha2_it->second, beta1_it->second))) {
@@ -7,6 +7,7 @@
 #include <optional>
 
 #include "cliques.hpp"
+#include "energy_delta.hpp"
 #include "multigraph.hpp"
 #include "solution.hpp"
 
@@ -25,7 +26,8 @@ namespace details {
                 std::vector<int> flip_indices;
                 double energy;
             };
-            CliqueSwapper(int num_graphs, std::shared_ptr<MgmModel> model, CliqueTable& current_state, int max_iterations_QPBO_I=100);
+            // `energy_delta` has to refer to `current_state`.
+            CliqueSwapper(int num_graphs, std::shared_ptr<MgmModel> model, CliqueTable& current_state, EnergyDelta& energy_delta, int max_iterations_QPBO_I=100);
 
             bool optimize(CliqueTable::Clique& A, CliqueTable::Clique& B);
             bool optimize_with_empty(CliqueTable::Clique& A);
@@ -42,13 +44,18 @@ namespace details {
 
             int max_iterations_QPBO_I = 100;
 
+            // Pairwise terms of the QPBO problem
+            EnergyDelta& energy_delta;
+
             bool run_qpbo_solver();
-            double star_flip_cost(int id_graph1, int id_graph2, int alpha1, int alpha2, int beta1, int beta2);
 
     };
 
     void flip(CliqueTable::Clique& A, CliqueTable::Clique& B, CliqueSwapper::Solution & solution);
 
+    // Graphs of all groups flipped by `solution`.
+    std::vector<int> flipped_graphs(const CliqueSwapper::Solution & solution);
+
 }
 
 //TODO: Write "Solver" Superclass, that defines model, current_state and export functions.
@@ -65,6 +72,7 @@ class SwapLocalSearcher {
         
     private:
         int current_step = 0;
+        double current_energy = 0.0; // Tracked by energy deltas
 
         void reset();
         bool iterate();
@@ -74,6 +82,7 @@ class SwapLocalSearcher {
         std::shared_ptr<MgmModel>               model;
         CliqueTable                             current_state;
         std::unique_ptr<details::CliqueSwapper>   clique_optimizer;
+        std::unique_ptr<EnergyDelta>              energy_delta; // Kept in sync with current_state. Shared with clique_optimizer.
 
         // State during iterations
         std::vector<bool> cliques_changed_prev;
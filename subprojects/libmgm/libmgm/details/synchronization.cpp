@@ -15,16 +15,18 @@ std::shared_ptr<MgmModel> build_sync_problem(std::shared_ptr<MgmModel> model, Mg
     sync_model->no_graphs = model->no_graphs;
     sync_model->graphs = model->graphs;
 
+    auto keys = model->model_keys();
     int i = 0;
-    for (const auto& [key, gm_model] : model->models) {
+    for (const auto& key : keys) {
+        auto gm_model = model->gm_model(key.first, key.second);
 
         // Progress, prints iterations on terminal.
         i++;
-        std::cout << i << "/" << model->models.size() << " \r";
+        std::cout << i << "/" << keys.size() << " \r";
         std::cout.flush();
 
         std::shared_ptr<GmModel> sync_gm_model;
-        GmSolution gm_sol(gm_model, solution.labeling().at(key));
+        GmSolution gm_sol(gm_model, solution.dense_labeling().to_vector(key));
 
         if (feasible) {
             // only allow assignments that are present
@@ -34,7 +36,7 @@ std::shared_ptr<MgmModel> build_sync_problem(std::shared_ptr<MgmModel> model, Mg
             // allow all assignments
             sync_gm_model = details::create_infeasible_sync_model(gm_sol);
         }
-        sync_model->models[key] = sync_gm_model;
+        sync_model->add_model(sync_gm_model);
     }
 
     return sync_model;
@@ -46,19 +48,12 @@ std::shared_ptr<GmModel>  create_feasible_sync_model(GmSolution& solution) {
     auto& model = solution.model;
     auto sync_model = std::make_shared<GmModel>(model->graph1, model->graph2, model->no_assignments(), 0);
     
-    // Copy assignments
-    // TODO: This is unnecessarily inefficient. Cost datastructure might be too restricted.
+    // Copy assignments. Labeled assignments cost -1, all others 0.
     for (const auto& idx : model->assignment_list) {
-        sync_model->add_assignment(idx.first, idx.second, 0);
-    }
-    
-    // set labeled assignments
-    for (int i = 0; i < static_cast<int>(solution.labeling().size()); ++i) {
-        if (solution[i] == -1)
-            continue;
-        
-        sync_model->costs->set_unary((int) i, solution[i], -1);
+        bool is_labeled = (solution[idx.first] == idx.second);
+        sync_model->add_assignment(idx.first, idx.second, is_labeled ? -1 : 0);
     }
+    sync_model->freeze();
 
     return sync_model;
 }
@@ -69,20 +64,13 @@ std::shared_ptr<GmModel>  create_infeasible_sync_model(GmSolution& solution) {
     int no_assignments = model->graph1.no_nodes * model->graph2.no_nodes;
     auto sync_model = std::make_shared<GmModel>(model->graph1, model->graph2, no_assignments, 0);
 
-    // Initialize all costs to 0
+    // All assignments. Labeled assignments cost -1, all others 0.
     for (auto i = 0; i  < model->graph1.no_nodes; i++) {
         for (auto j = 0; j  < model->graph2.no_nodes; j++) {
-            sync_model->add_assignment(i, j, 0);
+            sync_model->add_assignment(i, j, (solution[i] == j) ? -1 : 0);
         }
     }
-
-    // set labeled assignments
-    for (int i = 0; i < static_cast<int>(solution.labeling().size()); ++i) {
-        if (solution[i] == -1)
-            continue;
-        
-        sync_model->costs->set_unary((int) i, solution[i], -1);
-    }
+    sync_model->freeze();
 
     return sync_model;
 };
@@ -1,10 +1,13 @@
 #ifndef LIBMGM_MGM_H
 #define LIBMGM_MGM_H
 
+#include "details/arena.hpp"
 #include "details/cliques.hpp"
 #include "details/costs.hpp"
+#include "details/energy_delta.hpp"
 #include "details/io_utils.hpp"
 #include "details/logger.hpp"
+#include "details/memory_usage.hpp"
 #include "details/multigraph.hpp"
 #include "details/lap_interface.hpp"
 #include "details/qap_interface.hpp"
@@ -1,3 +1,5 @@
+import gzip
+
 import pylibmgm
 import pytest
 
@@ -18,6 +20,124 @@ def test_parsing(synth_4_model):
     assert synth_4_model.models[(0,1)].costs().pairwise(1, 0, 5, 3) == -1.9221
     assert synth_4_model.models[(0,1)].costs().pairwise(9, 8, 8, 9) == -1.3398
 
+def test_binary_roundtrip(house_8_model, tmp_path):
+    outpath = tmp_path / "house.mgmb"
+    pylibmgm.io.export_binary(outpath, house_8_model)
+    m = pylibmgm.io.parse_binary(outpath)
+
+    assert m.no_graphs == house_8_model.no_graphs
+    assert sorted(m.models.keys()) == sorted(house_8_model.models.keys())
+    for key, gm in house_8_model.models.items():
+        assert m.models[key].assignment_list == gm.assignment_list
+        assert m.models[key].no_edges() == gm.no_edges()
+
+    sol = pylibmgm.solver.solve_mgm(house_8_model, pylibmgm.solver.OptimizationLevel.FAST)
+    sol_binary = pylibmgm.MgmSolution(m)
+    sol_binary.set_solution(sol.labeling())
+    assert isclose(sol.evaluate(), sol_binary.evaluate())
+
+def test_lazy_loading(house_8_model):
+    model_path = Path(__file__).parent / "house_instance_1_nNodes_10_nGraphs_8.txt"
+    m = pylibmgm.io.open_lazy(model_path, memory_budget=1)
+
+    assert m.is_lazy()
+    assert m.no_graphs == house_8_model.no_graphs
+    assert sorted(m.model_keys()) == sorted(house_8_model.models.keys())
+    for key, gm in house_8_model.models.items():
+        assert m.gm_model(*key).assignment_list == gm.assignment_list
+
+    sol = pylibmgm.solver.solve_mgm(house_8_model, pylibmgm.solver.OptimizationLevel.FAST)
+    sol_lazy = pylibmgm.MgmSolution(m)
+    sol_lazy.set_solution(sol.labeling())
+    assert isclose(sol.evaluate(), sol_lazy.evaluate())
+
+    pairwise = pylibmgm.solver.solve_mgm_pairwise(m)
+    assert sorted(pairwise.labeling().keys()) == sorted(m.model_keys())
+    assert all(any(l >= 0 for l in gm_labeling) for gm_labeling in pairwise.labeling().values())
+
+    # Views forward to the models of the lazy parent
+    view = pylibmgm.MgmModelView(m, [6, 1, 3, 4])
+    assert view.is_lazy()
+    assert sorted(view.model_keys()) == [(l1, l2) for l2 in range(4) for l1 in range(l2)]
+    assert view.gm_model(0, 3).assignment_list == house_8_model.models[(1, 6)].assignment_list
+
+def assert_same_models(m, expected):
+    assert m.no_graphs == expected.no_graphs
+    assert sorted(m.models.keys()) == sorted(expected.models.keys())
+    for key, gm in expected.models.items():
+        assert m.models[key].assignment_list == gm.assignment_list
+        assert m.models[key].no_edges() == gm.no_edges()
+
+    sol = pylibmgm.solver.solve_mgm(expected, pylibmgm.solver.OptimizationLevel.FAST)
+    sol_m = pylibmgm.MgmSolution(m)
+    sol_m.set_solution(sol.labeling())
+    assert isclose(sol.evaluate(), sol_m.evaluate())
+
+def test_dd_export_roundtrip(house_8_model, tmp_path):
+    outpath = tmp_path / "house.dd"
+    pylibmgm.io.export_dd_file(outpath, house_8_model)
+    m = pylibmgm.io.parse_dd_file(outpath)
+
+    assert_same_models(m, house_8_model)
+
+# Synchronization models are built in memory and have no edges.
+def test_dd_export_roundtrip_sync(house_8_model, tmp_path):
+    sol = pylibmgm.solver.solve_mgm(house_8_model, pylibmgm.solver.OptimizationLevel.FAST)
+    sync_model = pylibmgm.build_sync_problem(house_8_model, sol, True)
+
+    outpath = tmp_path / "house_sync.dd"
+    pylibmgm.io.export_dd_file(outpath, sync_model)
+    m = pylibmgm.io.parse_dd_file(outpath)
+
+    assert_same_models(m, sync_model)
+
+# Compression support is optional in libmgm. Skips, if it was built without it.
+def parse_compressed(path):
+    try:
+        return pylibmgm.io.parse_dd_file(path)
+    except ValueError as e:
+        if "built without" in str(e):
+            pytest.skip(str(e))
+        raise
+
+class TestCompressed:
+    # The .gz file consists of two gzip members, split in the middle of a line.
+    @pytest.mark.parametrize("extension", [".gz", ".zst"])
+    def test_parsing(self, hotel_4_model, extension):
+        model_path = Path(__file__).parent / ("hotel_instance_1_nNodes_10_nGraphs_4.txt" + extension)
+        m = parse_compressed(model_path)
+
+        assert_same_models(m, hotel_4_model)
+
+    # Larger than a decompression chunk, so the model is passed on in several chunks.
+    def test_multiple_chunks(self, house_8_model, tmp_path):
+        data = (Path(__file__).parent / "house_instance_1_nNodes_10_nGraphs_8.txt").read_bytes()
+        outpath = tmp_path / "house.dd.gz"
+        outpath.write_bytes(b"".join(gzip.compress(data[i:i + 300000]) for i in range(0, len(data), 300000)))
+
+        m = parse_compressed(outpath)
+
+        assert_same_models(m, house_8_model)
+
+    # Decompression errors reach the caller instead of ending the input early.
+    @pytest.mark.parametrize("extension, format", [(".gz", "gzip"), (".zst", "zstd")])
+    def test_truncated(self, tmp_path, extension, format):
+        data = (Path(__file__).parent / ("hotel_instance_1_nNodes_10_nGraphs_4.txt" + extension)).read_bytes()
+        outpath = tmp_path / ("truncated.dd" + extension)
+        outpath.write_bytes(data[:len(data) // 3])
+
+        with pytest.raises(ValueError, match=f"Unexpected end of {format} file"):
+            parse_compressed(outpath)
+
+    def test_corrupt(self, tmp_path):
+        data = bytearray((Path(__file__).parent / "hotel_instance_1_nNodes_10_nGraphs_4.txt.gz").read_bytes())
+        data[len(data) // 4 : len(data) // 4 + 64] = bytes(64)
+        outpath = tmp_path / "corrupt.dd.gz"
+        outpath.write_bytes(bytes(data))
+
+        with pytest.raises(ValueError, match="Corrupt gzip file"):
+            parse_compressed(outpath)
+
 def test_solution_storing_loading(hotel_4_model, tmp_path):
         outpath = tmp_path / "sol.json"
 
@@ -69,4 +189,26 @@ class TestSafeToDiskFilename:
 
         pylibmgm.io.save_to_disk(outpath, sol)
 
-        assert(outpath_expected.exists())
\ No newline at end of file
+        assert(outpath_expected.exists())
+
+def test_binary_solution_storing_loading(hotel_4_model, tmp_path):
+        outpath = tmp_path / "sol.mgms"
+
+        sol = pylibmgm.solver.solve_mgm(hotel_4_model, pylibmgm.solver.OptimizationLevel.FAST)
+
+        pylibmgm.io.save_binary_solution(outpath, sol, compute_energy=False)
+        sol_parsed = pylibmgm.io.import_solution(outpath, hotel_4_model)
+
+        assert(sol.labeling() == sol_parsed.labeling())
+        assert(isclose(sol.evaluate(), sol_parsed.evaluate()))
+
+def test_clique_table_storing_loading(hotel_4_model, tmp_path):
+        outpath = tmp_path / "sol.cliques"
+
+        sol = pylibmgm.solver.solve_mgm(hotel_4_model, pylibmgm.solver.OptimizationLevel.FAST)
+
+        pylibmgm.io.save_clique_table(outpath, sol)
+        sol_parsed = pylibmgm.io.import_solution(outpath, hotel_4_model)
+
+        assert(sol.labeling() == sol_parsed.labeling())
+        assert(isclose(sol.evaluate(), sol_parsed.evaluate()))
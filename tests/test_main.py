@@ -23,6 +23,147 @@ def test_construction_incompl(request, model):
     
     assert not all(l >= 0 for gm_labeling in sol.labeling().values() for l in gm_labeling), "Solution should be incomplete"
 
+def test_gm_model_from_arrays():
+    g1 = pylibmgm.Graph(0, 2)
+    g2 = pylibmgm.Graph(1, 2)
+    assignments = [[0, 0], [0, 1], [1, 0], [1, 1]]
+    edges = [[0, 3], [1, 2]]
+    m = pylibmgm.GmModel.from_arrays(g1, g2, assignments, [1.0, 2.0, 3.0, 4.0], edges, [-5.0, -1.0])
+
+    assert m.no_assignments() == 4
+    assert m.no_edges() == 2
+    assert m.costs().unary(1, 0) == 3.0
+    assert m.costs().pairwise(0, 0, 1, 1) == -5.0
+    assert pylibmgm.GmSolution(m, [0, 1]).evaluate() == 0.0
+
+@pytest.mark.parametrize("model", ["hotel_4_model", "house_8_model"])
+def test_evaluate_matches_reference(request, model):
+    m = request.getfixturevalue(model)
+    constr = pylibmgm.SequentialGenerator(m)
+    constr.init(pylibmgm.MgmGenerator.matching_order.random)
+    sol = constr.generate()
+
+    for key, gm_labeling in sol.labeling().items():
+        gm_model = m.models[key]
+        expected = pylibmgm.GmSolution.evaluate_reference_static(gm_model, gm_labeling)
+        assert pylibmgm.GmSolution.evaluate_static(gm_model, gm_labeling) == pytest.approx(expected)
+
+def test_gm_model_lookup(house_8_model):
+    assert house_8_model.gm_model(0, 1) is house_8_model.models[(0, 1)]
+    assert house_8_model.gm_model(1, 0) is None
+    assert house_8_model.gm_model(-1, 1) is None
+    assert house_8_model.gm_model(0, 100) is None
+
+def test_model_view(house_8_model):
+    view = pylibmgm.MgmModelView(house_8_model, [6, 1, 3, 4])
+    assert view.no_graphs == 4
+    assert view.graph_ids() == [1, 3, 4, 6]
+    assert view.local_id(4) == 2
+    assert view.local_id(0) == -1
+    assert view.models[(0, 3)].graph1.id == 1 # Graph matching models are shared with the parent
+    assert view.models[(0, 3)].graph2.id == 6
+
+    constr = pylibmgm.SequentialGenerator(view)
+    constr.init(pylibmgm.MgmGenerator.matching_order.sequential)
+    sol = constr.generate()
+    assert sorted(sol.labeling().keys()) == sorted(view.models.keys())
+
+def test_memory_usage(house_8_model):
+    usage = house_8_model.memory_usage()
+    assert usage["costs.edges_csr"] > 0
+    assert usage["costs.edges_csr"] == sum(m.memory_usage()["costs.edges_csr"] for m in house_8_model.models.values())
+    assert usage["costs.edges"] == 0 # Released on freeze
+
+    constr = pylibmgm.SequentialGenerator(house_8_model)
+    constr.init(pylibmgm.MgmGenerator.matching_order.sequential)
+    sol = constr.generate()
+    assert sol.memory_usage()["labeling"] > 0
+
+def test_cached_energy(house_8_model):
+    constr = pylibmgm.SequentialGenerator(house_8_model)
+    constr.init(pylibmgm.MgmGenerator.matching_order.sequential)
+    sol = constr.generate()
+    sol.evaluate() # fills the cache
+
+    key = (0, 1)
+    labeling = sol[key]
+    labeling[0], labeling[1] = labeling[1], labeling[0]
+    sol[key] = labeling
+
+    fresh = pylibmgm.MgmSolution(house_8_model)
+    fresh.set_solution(sol.labeling())
+    assert sol.evaluate() == pytest.approx(fresh.evaluate())
+    assert sol.evaluate(key) == pytest.approx(pylibmgm.GmSolution.evaluate_static(house_8_model.models[key], labeling))
+    assert sol.evaluate(0) == pytest.approx(fresh.evaluate(0))
+
+def test_parallel_evaluation(house_8_model):
+    constr = pylibmgm.SequentialGenerator(house_8_model)
+    constr.init(pylibmgm.MgmGenerator.matching_order.sequential)
+    sol = constr.generate()
+
+    energies = []
+    try:
+        for threads in [1, 4]:
+            pylibmgm.MgmSolution.evaluation_threads = threads
+            fresh = pylibmgm.MgmSolution(house_8_model)
+            fresh.set_solution(sol.labeling())
+            energies.append(fresh.evaluate())
+    finally:
+        pylibmgm.MgmSolution.evaluation_threads = 0 # Static, shared with all other tests
+
+    assert energies[0] == energies[1] # bit-identical
+
+def test_dense_labeling(house_8_model):
+    constr = pylibmgm.SequentialGenerator(house_8_model)
+    constr.init(pylibmgm.MgmGenerator.matching_order.sequential)
+    sol = constr.generate()
+
+    dense = sol.dense_labeling()
+    labels = dense.labels()
+    assert dense.keys() == sorted(sol.labeling().keys())
+    for key in dense.keys():
+        offset = dense.offset(key)
+        assert list(labels[offset:offset + dense.size(key)]) == sol[key]
+    assert dense.to_dict() == sol.labeling()
+
+    copy = pylibmgm.MgmSolution(house_8_model)
+    copy.set_solution(dense)
+    assert copy.evaluate() == sol.evaluate()
+
+def _swapped(cliques, A, B, graph_ids):
+    cliques = [dict(c) for c in cliques]
+    for g in graph_ids:
+        alpha = cliques[A].pop(g, None)
+        beta = cliques[B].pop(g, None)
+        if alpha is not None:
+            cliques[B][g] = alpha
+        if beta is not None:
+            cliques[A][g] = beta
+    return [c for c in cliques if c]
+
+def test_energy_delta(house_8_model):
+    constr = pylibmgm.SequentialGenerator(house_8_model)
+    constr.init(pylibmgm.MgmGenerator.matching_order.sequential)
+    sol = constr.generate()
+
+    cliques = sol.clique_table()
+    delta = sol.energy_delta()
+    energy = sol.evaluate()
+
+    def evaluate(cliques):
+        materialized = pylibmgm.MgmSolution(house_8_model)
+        materialized.set_solution(cliques)
+        return materialized.evaluate()
+
+    A, B = 0, len(cliques) - 1
+    graphs = sorted(set(cliques[A]) | set(cliques[B]))
+    for g in graphs:
+        assert delta.move(g, A, B) == pytest.approx(evaluate(_swapped(cliques, A, B, [g])) - energy, abs=1e-6)
+    assert delta.swap(A, B, graphs[::2]) == pytest.approx(evaluate(_swapped(cliques, A, B, graphs[::2])) - energy, abs=1e-6)
+
+    for g in range(house_8_model.no_graphs):
+        assert pylibmgm.EnergyDelta.graph_energy(house_8_model, cliques, g) == pytest.approx(sol.evaluate(g))
+
 def test_gm_solver(opengm_model):
     solver = pylibmgm.QAPSolver(opengm_model)
     sol = solver.run()